@@ -0,0 +1,180 @@
+#include "sat.h"
+#include <stdint.h>
+
+// Bit-sliced exhaustive search.
+//
+// All the assignments are tried, 256 at a time: the value of a variable in 256 assignments is a
+// vector of 4 words of 64 bits (one bit per assignment, or "lane"). The first LANE_VARS variables
+// take all their possible combinations inside a vector (variable 1 is 0101..., variable 2 is
+// 0011..., and so on), the other ones ("outer" variables) are constant in a vector and enumerated
+// by a counter. A clause is then the OR of the vectors of its literals, and the formula the AND of
+// its clauses: the bits that remain give the lanes that are models.
+//
+// The range of the counter is split in blocks that are taken by NB_THREADS threads.
+
+// number of variables enumerated inside a vector (2^LANE_VARS lanes)
+#define LANE_VARS 8
+// number of values of the counter taken at once by a thread
+#define BLOCK 256
+
+// 4 words of 64 bits, with the usual bitwise operators (GCC vector extension)
+typedef uint64_t vec_t __attribute__((vector_size(32)));
+
+// data shared by the threads
+typedef struct {
+    formula_t* F;
+    int nb_outer;                   // number of outer variables
+    unsigned long long nb_iter;     // number of values of the counter (2^nb_outer)
+    unsigned long long next;        // next value of the counter to take
+    int count;                      // count all the models, or stop at the first one?
+    int stop;                       // set when a model was found (and we don't count)
+    unsigned long long nb_models;   // number of models found
+    int found;                      // set when a model was recorded
+    unsigned long long model_iter;  // the model: value of the counter...
+    int model_lane;                 // ... and lane
+    pthread_mutex_t lock;
+} brute_t;
+
+// values of the variables of the lanes in a vector
+static const vec_t Lanes[LANE_VARS] = {
+    { 0xAAAAAAAAAAAAAAAAULL, 0xAAAAAAAAAAAAAAAAULL, 0xAAAAAAAAAAAAAAAAULL, 0xAAAAAAAAAAAAAAAAULL },
+    { 0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCCULL, 0xCCCCCCCCCCCCCCCCULL },
+    { 0xF0F0F0F0F0F0F0F0ULL, 0xF0F0F0F0F0F0F0F0ULL, 0xF0F0F0F0F0F0F0F0ULL, 0xF0F0F0F0F0F0F0F0ULL },
+    { 0xFF00FF00FF00FF00ULL, 0xFF00FF00FF00FF00ULL, 0xFF00FF00FF00FF00ULL, 0xFF00FF00FF00FF00ULL },
+    { 0xFFFF0000FFFF0000ULL, 0xFFFF0000FFFF0000ULL, 0xFFFF0000FFFF0000ULL, 0xFFFF0000FFFF0000ULL },
+    { 0xFFFFFFFF00000000ULL, 0xFFFFFFFF00000000ULL, 0xFFFFFFFF00000000ULL, 0xFFFFFFFF00000000ULL },
+    { 0, ~0ULL, 0, ~0ULL },
+    { 0, 0, ~0ULL, ~0ULL },
+};
+
+// thread function: try the values of the counter, block by block
+static void* brute_worker(void* arg)
+{
+    brute_t* B = arg;
+    formula_t* F = B->F;
+    const vec_t zero = { 0, 0, 0, 0 };
+    const vec_t ones = { ~0ULL, ~0ULL, ~0ULL, ~0ULL };
+    vec_t M[2 * F->nb_var + 2]; // vector of each literal
+    for (int x = 1; x <= F->nb_var && x <= LANE_VARS; x++) {
+        M[2 * x + 1] = Lanes[x - 1];
+        M[2 * x] = ~Lanes[x - 1];
+    }
+    unsigned long long nb_models = 0;
+
+    while (1) {
+        unsigned long long block = __atomic_fetch_add(&B->next, BLOCK, __ATOMIC_RELAXED);
+        if (block >= B->nb_iter || __atomic_load_n(&B->stop, __ATOMIC_RELAXED)) {
+            break;
+        }
+        unsigned long long last = block + BLOCK < B->nb_iter ? block + BLOCK : B->nb_iter;
+        for (unsigned long long it = block; it < last; it++) {
+            // values of the outer variables
+            for (int k = 0; k < B->nb_outer; k++) {
+                int x = LANE_VARS + 1 + k;
+                M[2 * x + 1] = (it >> k) & 1 ? ones : zero;
+                M[2 * x] = (it >> k) & 1 ? zero : ones;
+            }
+            // evaluate the formula, and stop as soon as all the lanes are false
+            vec_t f = ones;
+            for (int cl = 0; cl < F->nb_cl; cl++) {
+                vec_t c = zero;
+                for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+                    c |= M[F->Lit[i]];
+                }
+                f &= c;
+                if ((f[0] | f[1] | f[2] | f[3]) == 0) {
+                    break;
+                }
+            }
+            if ((f[0] | f[1] | f[2] | f[3]) == 0) {
+                continue;
+            }
+
+            for (int w = 0; w < 4; w++) {
+                nb_models += __builtin_popcountll(f[w]);
+            }
+            if (!__atomic_load_n(&B->found, __ATOMIC_RELAXED)) {
+                pthread_mutex_lock(&B->lock);
+                if (!B->found) {
+                    int w = 0;
+                    while (f[w] == 0) {
+                        w++;
+                    }
+                    B->found = 1;
+                    B->model_iter = it;
+                    B->model_lane = 64 * w + __builtin_ctzll(f[w]);
+                }
+                pthread_mutex_unlock(&B->lock);
+            }
+            if (!B->count) {
+                __atomic_store_n(&B->stop, 1, __ATOMIC_RELAXED);
+                break;
+            }
+        }
+    }
+    __atomic_fetch_add(&B->nb_models, nb_models, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// look for a solution by trying all the assignments (at most MAX_BRUTE_VAR variables)
+// if count is not NULL, all the models are counted and their number is stored in *count
+// S may already contain some values, for variables that don't appear in F
+int solve_brute(formula_t* F, sol_t* S, unsigned long long* count)
+{
+    assert(F->nb_var <= MAX_BRUTE_VAR);
+    brute_t B;
+    B.F = F;
+    B.nb_outer = F->nb_var > LANE_VARS ? F->nb_var - LANE_VARS : 0;
+    B.nb_iter = 1ULL << B.nb_outer;
+    B.next = 0;
+    B.count = count != NULL;
+    B.stop = 0;
+    B.nb_models = 0;
+    B.found = 0;
+    pthread_mutex_init(&B.lock, NULL);
+
+    unsigned long long nb_blocks = (B.nb_iter + BLOCK - 1) / BLOCK;
+    int nb_threads = (unsigned long long)NB_THREADS < nb_blocks ? NB_THREADS : (int)nb_blocks;
+    if (nb_threads <= 1) {
+        brute_worker(&B);
+    } else {
+        pthread_t* Threads = malloc(nb_threads * sizeof(pthread_t));
+        for (int t = 0; t < nb_threads; t++) {
+            pthread_create(&Threads[t], NULL, brute_worker, &B);
+        }
+        for (int t = 0; t < nb_threads; t++) {
+            pthread_join(Threads[t], NULL);
+        }
+        free(Threads);
+    }
+    pthread_mutex_destroy(&B.lock);
+
+    if (count != NULL) {
+        // with less than LANE_VARS variables, each model appears in several lanes, and the
+        // variables already set in S don't appear in F but were counted as free
+        int shift = S->n;
+        if (F->nb_var < LANE_VARS) {
+            shift += LANE_VARS - F->nb_var;
+        }
+        *count = B.nb_models >> shift;
+        LOG(2, "%llu model(s)\n", *count);
+    }
+    if (!B.found) {
+        S->n = -1;
+        return 0;
+    }
+    for (int x = 1; x <= F->nb_var; x++) {
+        if (S->State[x] != UNSET) {
+            continue;
+        }
+        if (x <= LANE_VARS) {
+            S->State[x] = (B.model_lane >> (x - 1)) & 1;
+        } else {
+            S->State[x] = (B.model_iter >> (x - 1 - LANE_VARS)) & 1;
+        }
+        S->Var[S->n++] = x;
+    }
+    return 1;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
@@ -0,0 +1,455 @@
+#include "sat.h"
+
+// Cardinality constraints.
+//
+// A cardinality constraint l1 + ... + ln <= k says that at most k of its literals are true. It is
+// given in a DIMACS file by a line "l1 ... ln <= k" (or "l1 ... ln >= k", which is the constraint
+// -l1 + ... + -ln <= n-k). The pairwise encodings of at-most-one constraints (the binary clauses
+// -a v -b for all the pairs of a set of literals) are also recognized in the clauses: a constraint
+// of size n replaces n(n-1)/2 binary clauses.
+//
+// Only the DPLL search handles them natively, with a counter of true literals for each constraint:
+// when a constraint reaches its bound, its other literals are forced to be false. The other
+// algorithms and the preprocessing get them as clauses (the negations of all the sets of k+1
+// literals of a constraint).
+
+// smallest at-most-one constraint recognized in the binary clauses
+#define CARD_MIN_SIZE 3
+// maximal number of steps of the search for at-most-one constraints
+#define CARD_BUDGET 100000000L
+// maximal number of literals of the clauses given by the expansion of the constraints
+#define CARD_EXPAND_LIMIT 100000000L
+
+// turn the constraints that are not real cardinality constraints into clauses: a constraint with a
+// negative bound is an empty clause, a constraint with a bound of 0 gives unit clauses, and a
+// constraint with a bound of n-1 is the clause of the negations of its n literals, while a
+// constraint with a bound of at least n is always satisfied
+// the constraints where a variable appears twice are rejected
+void normalize_cards(formula_t* F)
+{
+    char* Seen = calloc(F->nb_var + 1, sizeof(char));
+    // a constraint gives at most one clause per literal
+    int* Cl = malloc((F->Card[F->nb_card] + 1) * sizeof(int));
+    int* Lit = malloc((F->Card[F->nb_card] + 1) * sizeof(int));
+    int nb_cl = 0;
+    int nb_lit = 0;
+    int nb_card = 0;
+    int nb_card_lit = 0;
+    Cl[0] = 0;
+    for (int c = 0; c < F->nb_card; c++) {
+        int start = F->Card[c];
+        int size = F->Card[c + 1] - start;
+        int bound = F->Bound[c];
+        for (int i = start; i < start + size; i++) {
+            int x = VARIABLE(F->CardLit[i]);
+            if (Seen[x]) {
+                fprintf(stderr, "*** variable %d appears twice in a cardinality constraint\n", x);
+                exit(3);
+            }
+            Seen[x] = 1;
+        }
+        for (int i = start; i < start + size; i++) {
+            Seen[VARIABLE(F->CardLit[i])] = 0;
+        }
+        if (bound >= size) {
+            continue;
+        }
+        if (bound < 0 || bound == size - 1) {
+            // empty clause, or clause of the negations
+            for (int i = start; i < start + size && bound >= 0; i++) {
+                Lit[nb_lit++] = F->CardLit[i] ^ 1;
+            }
+            Cl[++nb_cl] = nb_lit;
+            continue;
+        }
+        if (bound == 0) {
+            for (int i = start; i < start + size; i++) {
+                Lit[nb_lit++] = F->CardLit[i] ^ 1;
+                Cl[++nb_cl] = nb_lit;
+            }
+            continue;
+        }
+        // the constraint is kept (it is moved towards the beginning of the arrays)
+        F->Card[nb_card] = nb_card_lit;
+        F->Bound[nb_card] = bound;
+        for (int i = start; i < start + size; i++) {
+            F->CardLit[nb_card_lit++] = F->CardLit[i];
+        }
+        nb_card++;
+    }
+    F->nb_card = nb_card;
+    F->Card[nb_card] = nb_card_lit;
+    append_clauses(F, Cl, Lit, nb_cl, nb_lit);
+    free(Seen);
+    free(Cl);
+    free(Lit);
+}
+
+// replace the cardinality constraints by clauses: for each set of k+1 literals of a constraint
+// with bound k, one of them is false
+void expand_cards(formula_t* F)
+{
+    if (F->nb_card == 0) {
+        return;
+    }
+    // number of literals of the clauses
+    long total = 0;
+    for (int c = 0; c < F->nb_card; c++) {
+        int n = F->Card[c + 1] - F->Card[c];
+        int m = F->Bound[c] + 1;
+        // binomial coefficient C(n, m), computed incrementally (C(n-m+i, i) for i = 1 ... m)
+        long nb = 1;
+        for (int i = 1; i <= m && nb <= CARD_EXPAND_LIMIT; i++) {
+            nb = nb * (n - m + i) / i;
+        }
+        total += nb * m;
+        if (total > CARD_EXPAND_LIMIT) {
+            fprintf(stderr, "*** too many clauses to expand the cardinality constraints (only DPLL "
+                            "handles them)\n");
+            exit(1);
+        }
+    }
+    int* Lit = malloc((total + 1) * sizeof(int));
+    int* Cl = malloc((total + 1) * sizeof(int));
+    int nb_cl = 0;
+    int nb_lit = 0;
+    Cl[0] = 0;
+    for (int c = 0; c < F->nb_card; c++) {
+        int* L = F->CardLit + F->Card[c];
+        int n = F->Card[c + 1] - F->Card[c];
+        int m = F->Bound[c] + 1;
+        // the sets of m literals, as increasing sequences of indices
+        int Idx[m];
+        for (int i = 0; i < m; i++) {
+            Idx[i] = i;
+        }
+        while (1) {
+            for (int i = 0; i < m; i++) {
+                Lit[nb_lit++] = L[Idx[i]] ^ 1;
+            }
+            Cl[++nb_cl] = nb_lit;
+            int i = m - 1;
+            while (i >= 0 && Idx[i] == n - m + i) {
+                i--;
+            }
+            if (i < 0) {
+                break;
+            }
+            Idx[i]++;
+            for (int j = i + 1; j < m; j++) {
+                Idx[j] = Idx[j - 1] + 1;
+            }
+        }
+    }
+    LOG(1, "%d cardinality constraint(s) expanded into %d clause(s)\n", F->nb_card, nb_cl);
+    append_clauses(F, Cl, Lit, nb_cl, nb_lit);
+    F->nb_card = 0;
+    F->Card[0] = 0;
+    free(Lit);
+    free(Cl);
+}
+
+// add a cardinality constraint at the end of the constraints of F
+static void push_card(formula_t* F, int* lits, int size, int bound)
+{
+    int nb_card_lit = F->Card[F->nb_card];
+    F->CardLit = realloc(F->CardLit, (nb_card_lit + size + 1) * sizeof(int));
+    F->Card = realloc(F->Card, (F->nb_card + 2) * sizeof(int));
+    F->Bound = realloc(F->Bound, (F->nb_card + 1) * sizeof(int));
+    memcpy(F->CardLit + nb_card_lit, lits, size * sizeof(int));
+    F->Bound[F->nb_card] = bound;
+    F->Card[++F->nb_card] = nb_card_lit + size;
+}
+
+// look for the at-most-one constraints encoded by binary clauses
+// the literals are the vertices of a graph where a binary clause -a v -b is an edge between a and
+// b: each clique of this graph is an at-most-one constraint. The cliques are grown greedily from
+// the edges (starting from the literals of highest degree), by adding the common neighbour of
+// their members that has the most neighbours among the other candidates, and the binary clauses
+// between the literals of a clique that is large enough are removed.
+// returns the number of constraints found
+int find_cards(formula_t* F)
+{
+    int N = 2 * F->nb_var + 2;
+    int* Start = calloc(N + 1, sizeof(int));
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        int* c = F->Lit + F->Cl[cl];
+        if (F->Cl[cl + 1] - F->Cl[cl] == 2 && VARIABLE(c[0]) != VARIABLE(c[1])) {
+            Start[(c[0] ^ 1) + 1]++;
+            Start[(c[1] ^ 1) + 1]++;
+        }
+    }
+    for (int lit = 0; lit < N; lit++) {
+        Start[lit + 1] += Start[lit];
+    }
+    if (Start[N] < 2 * CARD_MIN_SIZE) {
+        free(Start);
+        return 0;
+    }
+    // the neighbours of lit are Adj[Start[lit]] ... Adj[Start[lit+1]-1], and AdjCl gives the
+    // binary clauses
+    int* Adj = malloc(Start[N] * sizeof(int));
+    int* AdjCl = malloc(Start[N] * sizeof(int));
+    int* Next = malloc(N * sizeof(int));
+    memcpy(Next, Start, N * sizeof(int));
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        int* c = F->Lit + F->Cl[cl];
+        if (F->Cl[cl + 1] - F->Cl[cl] == 2 && VARIABLE(c[0]) != VARIABLE(c[1])) {
+            int a = c[0] ^ 1;
+            int b = c[1] ^ 1;
+            AdjCl[Next[a]] = cl;
+            Adj[Next[a]++] = b;
+            AdjCl[Next[b]] = cl;
+            Adj[Next[b]++] = a;
+        }
+    }
+    // the literals by decreasing degree (counting sort)
+    int max_degree = 0;
+    for (int lit = 0; lit < N; lit++) {
+        int degree = Start[lit + 1] - Start[lit];
+        max_degree = degree > max_degree ? degree : max_degree;
+    }
+    int* Pos = calloc(max_degree + 2, sizeof(int));
+    for (int lit = 0; lit < N; lit++) {
+        Pos[max_degree - (Start[lit + 1] - Start[lit]) + 1]++;
+    }
+    for (int d = 0; d <= max_degree; d++) {
+        Pos[d + 1] += Pos[d];
+    }
+    int* Order = malloc(N * sizeof(int));
+    for (int lit = 0; lit < N; lit++) {
+        Order[Pos[max_degree - (Start[lit + 1] - Start[lit])]++] = lit;
+    }
+
+    char* Covered = calloc(F->nb_cl, sizeof(char)); // binary clauses of a constraint
+    char* Tried = calloc(F->nb_cl, sizeof(char));   // edges that started a clique
+    char* InClique = calloc(N, sizeof(char));
+    int* Mark = calloc(N, sizeof(int)); // the candidates are marked with the last stamp
+    int* Cand = malloc(N * sizeof(int));
+    int* Members = malloc(N * sizeof(int));
+    int stamp = 0;
+    int nb_found = 0;
+    int nb_removed = 0;
+    long steps = 0;
+    for (int k = 0; k < N && steps < CARD_BUDGET; k++) {
+        int a = Order[k];
+        for (int e = Start[a]; e < Start[a + 1] && steps < CARD_BUDGET; e++) {
+            if (Covered[AdjCl[e]] || Tried[AdjCl[e]]) {
+                continue;
+            }
+            Tried[AdjCl[e]] = 1;
+            int b = Adj[e];
+            int size = 0;
+            Members[size++] = a;
+            Members[size++] = b;
+            // the candidates are the common neighbours of the members
+            stamp++;
+            for (int j = Start[b]; j < Start[b + 1]; j++) {
+                Mark[Adj[j]] = stamp;
+            }
+            stamp++;
+            int nb_cand = 0;
+            for (int j = Start[a]; j < Start[a + 1]; j++) {
+                if (Mark[Adj[j]] == stamp - 1) {
+                    Mark[Adj[j]] = stamp;
+                    Cand[nb_cand++] = Adj[j];
+                }
+            }
+            steps += Start[a + 1] - Start[a] + Start[b + 1] - Start[b];
+            while (nb_cand > 0) {
+                // the candidate adjacent to the most other candidates joins the clique
+                int best = 0;
+                int best_score = -1;
+                for (int i = 0; i < nb_cand; i++) {
+                    int score = 0;
+                    for (int j = Start[Cand[i]]; j < Start[Cand[i] + 1]; j++) {
+                        score += Mark[Adj[j]] == stamp;
+                    }
+                    steps += Start[Cand[i] + 1] - Start[Cand[i]];
+                    if (score > best_score) {
+                        best = i;
+                        best_score = score;
+                    }
+                }
+                int m = Cand[best];
+                Members[size++] = m;
+                stamp++;
+                for (int j = Start[m]; j < Start[m + 1]; j++) {
+                    if (Mark[Adj[j]] == stamp - 1) {
+                        Mark[Adj[j]] = stamp;
+                    }
+                }
+                int n = 0;
+                for (int i = 0; i < nb_cand; i++) {
+                    if (Mark[Cand[i]] == stamp) {
+                        Cand[n++] = Cand[i];
+                    }
+                }
+                nb_cand = n;
+            }
+            if (size >= CARD_MIN_SIZE) {
+                push_card(F, Members, size, 1);
+                nb_found++;
+                for (int i = 0; i < size; i++) {
+                    InClique[Members[i]] = 1;
+                }
+                for (int i = 0; i < size; i++) {
+                    int m = Members[i];
+                    for (int j = Start[m]; j < Start[m + 1]; j++) {
+                        if (InClique[Adj[j]] && !Covered[AdjCl[j]]) {
+                            Covered[AdjCl[j]] = 1;
+                            nb_removed++;
+                        }
+                    }
+                }
+                for (int i = 0; i < size; i++) {
+                    InClique[Members[i]] = 0;
+                }
+            }
+        }
+    }
+
+    if (nb_removed > 0) {
+        // remove the binary clauses of the constraints
+        int nb_cl = 0;
+        int nb_lit = 0;
+        int start = F->Cl[0];
+        for (int cl = 0; cl < F->nb_cl; cl++) {
+            int end = F->Cl[cl + 1];
+            if (!Covered[cl]) {
+                F->Cl[nb_cl++] = nb_lit;
+                for (int i = start; i < end; i++) {
+                    F->Lit[nb_lit++] = F->Lit[i];
+                }
+            }
+            start = end;
+        }
+        F->nb_cl = nb_cl;
+        F->nb_lit = nb_lit;
+        F->Cl[nb_cl] = nb_lit;
+    }
+    LOG(1, "%d at-most-one constraint(s) found, %d binary clause(s) removed\n", nb_found,
+        nb_removed);
+    free(Start);
+    free(Adj);
+    free(AdjCl);
+    free(Next);
+    free(Pos);
+    free(Order);
+    free(Covered);
+    free(Tried);
+    free(InClique);
+    free(Mark);
+    free(Cand);
+    free(Members);
+    return nb_found;
+}
+
+/////////////////////////////////
+// propagation in the DPLL search
+
+// create the counters of the constraints of F (no variable is set yet)
+cardlist_t* new_cardlist(formula_t* F)
+{
+    cardlist_t* K = malloc(sizeof(cardlist_t));
+    int N = 2 * F->nb_var + 2;
+    int nb_card_lit = F->Card[F->nb_card];
+    K->Start = calloc(N + 1, sizeof(int));
+    K->Occ = malloc((nb_card_lit + 1) * sizeof(int));
+    for (int i = 0; i < nb_card_lit; i++) {
+        K->Start[F->CardLit[i] + 1]++;
+    }
+    for (int lit = 0; lit < N; lit++) {
+        K->Start[lit + 1] += K->Start[lit];
+    }
+    // fill the lists, Start[lit] is used as the next free position of the list of lit...
+    for (int c = 0; c < F->nb_card; c++) {
+        for (int i = F->Card[c]; i < F->Card[c + 1]; i++) {
+            K->Occ[K->Start[F->CardLit[i]]++] = c;
+        }
+    }
+    // ... so that it ends up at the start of the next list
+    for (int lit = N; lit > 0; lit--) {
+        K->Start[lit] = K->Start[lit - 1];
+    }
+    K->Start[0] = 0;
+    K->NbTrue = calloc(F->nb_card + 1, sizeof(int));
+    // between two backtracks, each constraint reaches its bound at most once
+    K->Forced = malloc((nb_card_lit + 1) * sizeof(int));
+    K->nb_forced = 0;
+    K->nb_var = F->nb_var;
+    K->next_var = 1;
+    return K;
+}
+
+// free the counters of constraints
+void free_cardlist(cardlist_t* K)
+{
+    if (K == NULL)
+        return;
+    free(K->Start);
+    free(K->Occ);
+    free(K->NbTrue);
+    free(K->Forced);
+    free(K);
+}
+
+// a literal became true: the constraints that contain it have one more true literal, and the
+// unset literals of the constraints that reach their bound must be false
+// returns 0 if a constraint has too many true literals
+int assign_cards(formula_t* F, sol_t* S, cardlist_t* K, int lit)
+{
+    int ok = 1;
+    for (int k = K->Start[lit]; k < K->Start[lit + 1]; k++) {
+        int c = K->Occ[k];
+        if (++K->NbTrue[c] > F->Bound[c]) {
+            ok = 0;
+        } else if (K->NbTrue[c] == F->Bound[c]) {
+            for (int i = F->Card[c]; i < F->Card[c + 1]; i++) {
+                if (S->State[VARIABLE(F->CardLit[i])] == UNSET) {
+                    K->Forced[K->nb_forced++] = F->CardLit[i] ^ 1;
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+// a literal isn't true anymore (its variable may be unset)
+void unassign_cards(cardlist_t* K, int lit)
+{
+    for (int k = K->Start[lit]; k < K->Start[lit + 1]; k++) {
+        K->NbTrue[K->Occ[k]]--;
+    }
+    if (VARIABLE(lit) < K->next_var) {
+        K->next_var = VARIABLE(lit);
+    }
+}
+
+// return a literal forced by the constraints that is still unset, or EOL if there is none
+// NOTE: the Forced stack must be emptied after each backtrack, as for unit clauses
+int next_card_literal(sol_t* S, cardlist_t* K)
+{
+    while (K->nb_forced > 0) {
+        int lit = K->Forced[--K->nb_forced];
+        if (S->State[VARIABLE(lit)] == UNSET) {
+            return lit;
+        }
+    }
+    return EOL;
+}
+
+// return an unset variable of the constraints, or EOL if they are all set
+// (the variables that only appear in the constraints are not in the active list)
+int unset_card_var(sol_t* S, cardlist_t* K)
+{
+    for (; K->next_var <= K->nb_var; K->next_var++) {
+        int x = K->next_var;
+        if (S->State[x] == UNSET && K->Start[2 * x + 2] > K->Start[2 * x]) {
+            return x;
+        }
+    }
+    return EOL;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
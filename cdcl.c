@@ -0,0 +1,957 @@
+#include "sat.h"
+
+// Conflict driven clause learning.
+//
+// The trail is the Var array of the sol_t: S->Var[0 .. S->n-1] lists the assigned variables in
+// the order they were assigned, and C->TrailLim[d] gives the position in the trail where decision
+// level d+1 starts. Each clause is watched by its first two literals (the watch lists are the
+// same as for the DPLL algorithm, with blocking literals). When a conflict is found,
+// we learn a new clause (first UIP), add it to the clause arena and jump back to the second
+// highest decision level of this clause.
+//
+// The clauses live in a clause arena (the formula itself is not modified), where learned clauses
+// can be added and deleted cheaply. Regularly, the least useful half of the learned clauses
+// (highest LBD, lowest activity) is deleted, and the arena is compacted when enough memory is
+// wasted by deleted clauses.
+//
+// From time to time (according to the restart policy), we go back to level 0 and start the search
+// again, keeping the learned clauses. The polarity of each variable is saved when it is unassigned
+// (phase saving), so that restarts don't lose the progress made towards a solution.
+//
+// At some restarts, the clauses are vivified: the negations of the literals of a clause are
+// assigned one at a time and propagated (without the clause itself). A conflict or a literal of
+// the clause found true means that the literals assigned so far are enough, and a literal found
+// false can be removed. The vivification gets a fixed share of the propagations of the search.
+
+// number of conflicts before the first reduction of the learned clauses, and increment of this
+// number after each reduction
+#define REDUCE_FIRST 2000
+#define REDUCE_INC 300
+// after each conflict, the activity of the learned clauses decays by this factor
+#define CLAUSE_DECAY 0.999
+// number of conflicts between two vivifications
+#define VIVIFY_INTERVAL 3000
+// the vivification takes at most 1/VIVIFY_SHARE of the propagations
+#define VIVIFY_SHARE 20
+
+////////////////////////////////
+// creating / freeing the engine
+
+// value of a literal: TRUE, FALSE or UNSET
+static inline int value(cdcl_t* C, int lit) { return C->Val[lit]; }
+
+// add a literal to the trail
+static void assign(cdcl_t* C, int lit, int reason)
+{
+    int x = VARIABLE(lit);
+    assert(C->Val[lit] == UNSET);
+    C->Val[lit] = TRUE;
+    C->Val[lit ^ 1] = FALSE;
+    // decisions can be changed, everything else (including level 0) is forced
+    C->S->State[x] = (reason == EOL && C->level > 0 ? FALSE : FORCED_FALSE) + SIGN(lit);
+    C->Level[x] = C->level;
+    C->Reason[x] = reason;
+    C->S->Var[C->S->n++] = x;
+}
+
+static int add_clause(cdcl_t* C, int* lits, int size, int learnt);
+
+// initialize the engine for a formula
+// if O is not NULL, it is used to choose decision variables (VSIDS)
+cdcl_t* new_cdcl(formula_t* F, sol_t* S, order_t* O)
+{
+    cdcl_t* C = malloc(sizeof(cdcl_t));
+    int n = F->nb_var;
+    C->F = F;
+    C->S = S;
+    C->O = O;
+    C->Level = malloc((n + 1) * sizeof(int));
+    C->Reason = malloc((n + 1) * sizeof(int));
+    C->TrailLim = malloc((n + 1) * sizeof(int));
+    C->Seen = calloc(n + 1, sizeof(char));
+    C->Learnt = malloc((n + 1) * sizeof(int));
+    C->Phase = calloc(n + 1, sizeof(char));
+    C->Stamp = calloc(n + 1, sizeof(int));
+    C->stamp = 0;
+    C->Val = malloc((2 * n + 2) * sizeof(char));
+    for (int l = 0; l < 2 * n + 2; l++) {
+        C->Val[l] = UNSET;
+    }
+    // the trail may already contain variables assigned by the preprocessing
+    for (int x = 0; x <= n; x++) {
+        C->Level[x] = 0;
+        C->Reason[x] = EOL;
+    }
+    C->level = 0;
+    C->qhead = 0;
+    C->next_var = 1;
+    C->phase_saving = PHASE_SAVING;
+    C->restart = RESTART;
+    C->luby_unit = LUBY_UNIT;
+    C->restart_conflicts = 0;
+    C->max_conflicts = -1;
+    C->Stop = NULL;
+    C->ema_fast = 0.0;
+    C->ema_slow = 0.0;
+    C->size_learnts = 1024;
+    C->Learnts = malloc(C->size_learnts * sizeof(int));
+    C->nb_learnts = 0;
+    C->cla_inc = 1.0;
+    C->next_reduce = REDUCE_FIRST;
+    C->nb_decisions = 0;
+    C->nb_conflicts = 0;
+    C->nb_propagations = 0;
+    C->nb_learnt = 0;
+    C->nb_restarts = 0;
+    C->nb_reductions = 0;
+    C->nb_deleted = 0;
+    C->Share = NULL;
+    C->share_id = 0;
+    C->Read = NULL;
+    C->exported = 0;
+    C->nb_exported = 0;
+    C->nb_imported = 0;
+    C->Assumptions = NULL;
+    C->nb_assumptions = 0;
+    C->Failed = NULL;
+    C->nb_failed = 0;
+    C->max_level = n;
+    C->next_vivify = VIVIFY_INTERVAL;
+    C->vivify_next = 0;
+    C->vivify_props = 0;
+    C->nb_vivified = 0;
+    C->nb_vivified_lits = 0;
+    C->unsat = 0;
+
+    C->A = new_arena(F->nb_lit + CLAUSE_WORDS(0) * F->nb_cl);
+    C->W = new_watchlist(n, 0);
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        int size = F->Cl[cl + 1] - F->Cl[cl];
+        int* c = F->Lit + F->Cl[cl];
+        if (size == 0) {
+            LOG(1, "Empty clause in initial problem...\n");
+            C->unsat = 1;
+        } else if (size > 1) {
+            add_clause(C, c, size, 0);
+        } else if (value(C, c[0]) == FALSE) {
+            // unit clauses are not stored, their literal is directly assigned at level 0
+            C->unsat = 1;
+        } else if (value(C, c[0]) == UNSET) {
+            assign(C, c[0], EOL);
+        }
+    }
+    return C;
+}
+
+// free the engine (the formula and the solution are not freed)
+void free_cdcl(cdcl_t* C)
+{
+    if (C == NULL)
+        return;
+    free_watchlist(C->W);
+    free_arena(C->A);
+    free(C->Learnts);
+    free(C->Assumptions);
+    free(C->Failed);
+    free(C->Stamp);
+    free(C->Val);
+    free(C->Learnt);
+    free(C->Phase);
+    free(C->Seen);
+    free(C->TrailLim);
+    free(C->Reason);
+    free(C->Level);
+    free(C);
+}
+
+// add a clause (of size at least 2) to the arena, and watch its first two literals
+// returns the reference of the clause
+static int add_clause(cdcl_t* C, int* lits, int size, int learnt)
+{
+    int cr = alloc_clause(C->A, lits, size, learnt);
+    add_watcher(C->W, lits[0], cr, lits[1]);
+    add_watcher(C->W, lits[1], cr, lits[0]);
+    if (learnt) {
+        if (C->nb_learnts == C->size_learnts) {
+            C->size_learnts *= 2;
+            C->Learnts = realloc(C->Learnts, C->size_learnts * sizeof(int));
+        }
+        C->Learnts[C->nb_learnts++] = cr;
+    }
+    return cr;
+}
+
+/////////////////////
+// unit propagation
+
+// propagate all the assignments of the trail that haven't been propagated yet
+// returns the index of a false clause, or EOL if there is no conflict
+static int propagate(cdcl_t* C)
+{
+    sol_t* S = C->S;
+    watchlist_t* W = C->W;
+    while (C->qhead < S->n) {
+        int x = S->Var[C->qhead++];
+        int lit = 2 * x + 1 - (S->State[x] & 1); // the literal of x that has just become false
+        watcher_t* ws = W->Watch[lit];
+        int size = W->Size[lit];
+        int i, j;
+        C->nb_propagations++;
+
+        for (i = j = 0; i < size; i++) {
+            // the blocking literal is true: the clause is satisfied
+            if (value(C, ws[i].blocker) == TRUE) {
+                ws[j++] = ws[i];
+                continue;
+            }
+            int cl = ws[i].cl;
+            int* c = CLAUSE(C->A, cl)->lits;
+            int end = CLAUSE(C->A, cl)->size;
+
+            // make sure the false literal is c[1]
+            if (c[0] == lit) {
+                c[0] = c[1];
+                c[1] = lit;
+            }
+            // the other watched literal is true: it becomes the blocking literal
+            if (value(C, c[0]) == TRUE) {
+                ws[j].cl = cl;
+                ws[j++].blocker = c[0];
+                continue;
+            }
+            // look for a new literal to watch
+            int k;
+            for (k = 2; k < end; k++) {
+                if (value(C, c[k]) != FALSE) {
+                    break;
+                }
+            }
+            if (k < end) {
+                c[1] = c[k];
+                c[k] = lit;
+                add_watcher(W, c[1], cl, c[0]);
+                continue;
+            }
+            // the clause is unit or false
+            ws[j++] = ws[i];
+            if (value(C, c[0]) == FALSE) {
+                LOG(3, "! ! !  La clause %d est fausse car tous ces littéraux sont faux.\n", cl);
+                while (++i < size) {
+                    ws[j++] = ws[i];
+                }
+                W->Size[lit] = j;
+                C->qhead = S->n;
+                return cl;
+            }
+            assign(C, c[0], cl);
+        }
+        W->Size[lit] = j;
+    }
+    return EOL;
+}
+
+//////////////////////
+// conflict analysis
+
+// is a literal of the learned clause implied by the other literals?
+// (all the literals of its reason are either in the clause or fixed at level 0)
+static int redundant(cdcl_t* C, int lit)
+{
+    int r = C->Reason[VARIABLE(lit)];
+    if (r == EOL) {
+        return 0;
+    }
+    clause_t* c = CLAUSE(C->A, r);
+    for (int k = 1; k < (int)c->size; k++) {
+        int y = VARIABLE(c->lits[k]);
+        if (!C->Seen[y] && C->Level[y] > 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// increase the activity of a learned clause that took part in a conflict
+static void bump_clause(cdcl_t* C, clause_t* c)
+{
+    c->activity += C->cla_inc;
+    if (c->activity > 1e20) {
+        // rescale all the activities to avoid overflows (this doesn't change the order)
+        for (int i = 0; i < C->nb_learnts; i++) {
+            CLAUSE(C->A, C->Learnts[i])->activity *= 1e-20;
+        }
+        C->cla_inc *= 1e-20;
+    }
+}
+
+// compute the first UIP clause from a conflict
+// the learned clause is stored in C->Learnt (the asserting literal first, and a literal of the
+// backjump level second), its size is returned, the backjump level is stored in *blevel and the
+// number of distinct levels in the clause (LBD) in *lbd
+static int analyze(cdcl_t* C, int confl, int* blevel, int* lbd)
+{
+    sol_t* S = C->S;
+    int* Learnt = C->Learnt;
+    int size = 1; // Learnt[0] is reserved for the asserting literal
+    int pending = 0; // number of literals of the current level that still need to be resolved
+    int p = EOL;
+    int idx = S->n - 1;
+
+    do {
+        assert(confl != EOL);
+        clause_t* c = CLAUSE(C->A, confl);
+        if (c->learnt) {
+            bump_clause(C, c);
+        }
+        // the first literal of a reason clause is the literal it implied
+        for (int k = (p == EOL ? 0 : 1); k < (int)c->size; k++) {
+            int q = c->lits[k];
+            int y = VARIABLE(q);
+            if (C->Seen[y] || C->Level[y] == 0) {
+                continue;
+            }
+            C->Seen[y] = 1;
+            if (C->O != NULL) {
+                bump_order(C->O, y);
+            }
+            if (C->Level[y] >= C->level) {
+                pending++;
+            } else {
+                Learnt[size++] = q;
+            }
+        }
+        // next literal of the trail to look at
+        while (!C->Seen[S->Var[idx]]) {
+            idx--;
+        }
+        int x = S->Var[idx--];
+        p = 2 * x + (S->State[x] & 1);
+        confl = C->Reason[x];
+        C->Seen[x] = 0;
+        pending--;
+    } while (pending > 0);
+    Learnt[0] = p ^ 1;
+
+    // remove literals implied by other literals of the clause
+    // (unmarking a removed literal straight away only makes the test more strict)
+    int i, j;
+    for (i = j = 1; i < size; i++) {
+        if (!redundant(C, Learnt[i])) {
+            Learnt[j++] = Learnt[i];
+        } else {
+            C->Seen[VARIABLE(Learnt[i])] = 0;
+        }
+    }
+    size = j;
+    for (i = 1; i < size; i++) {
+        C->Seen[VARIABLE(Learnt[i])] = 0;
+    }
+
+    // find the backjump level, and put a literal of that level in second position
+    *blevel = 0;
+    if (size > 1) {
+        int max = 1;
+        for (i = 2; i < size; i++) {
+            if (C->Level[VARIABLE(Learnt[i])] > C->Level[VARIABLE(Learnt[max])]) {
+                max = i;
+            }
+        }
+        int tmp = Learnt[1];
+        Learnt[1] = Learnt[max];
+        Learnt[max] = tmp;
+        *blevel = C->Level[VARIABLE(Learnt[1])];
+    }
+
+    // count the distinct levels of the clause (the current level is the level of Learnt[0])
+    C->stamp++;
+    *lbd = 0;
+    for (i = 0; i < size; i++) {
+        int l = i == 0 ? C->level : C->Level[VARIABLE(Learnt[i])];
+        if (C->Stamp[l] != C->stamp) {
+            C->Stamp[l] = C->stamp;
+            (*lbd)++;
+        }
+    }
+    return size;
+}
+
+// find the assumptions responsible for the assumption p being false
+// they are stored in C->Failed (p first)
+static void analyze_final(cdcl_t* C, int p)
+{
+    sol_t* S = C->S;
+    C->Failed[0] = p;
+    C->nb_failed = 1;
+    if (C->level == 0) {
+        return;
+    }
+    C->Seen[VARIABLE(p)] = 1;
+    for (int i = S->n - 1; i >= C->TrailLim[0]; i--) {
+        int x = S->Var[i];
+        if (!C->Seen[x]) {
+            continue;
+        }
+        if (C->Reason[x] == EOL) {
+            // all the decisions are assumptions at this point
+            C->Failed[C->nb_failed++] = 2 * x + (S->State[x] & 1);
+        } else {
+            clause_t* c = CLAUSE(C->A, C->Reason[x]);
+            for (int k = 1; k < (int)c->size; k++) {
+                if (C->Level[VARIABLE(c->lits[k])] > 0) {
+                    C->Seen[VARIABLE(c->lits[k])] = 1;
+                }
+            }
+        }
+        C->Seen[x] = 0;
+    }
+    C->Seen[VARIABLE(p)] = 0;
+}
+
+// remove all the assignments above the given decision level
+static void cancel_until(cdcl_t* C, int level)
+{
+    sol_t* S = C->S;
+    if (C->level <= level) {
+        return;
+    }
+    for (int i = S->n - 1; i >= C->TrailLim[level]; i--) {
+        int x = S->Var[i];
+        C->Val[2 * x] = UNSET;
+        C->Val[2 * x + 1] = UNSET;
+        if (C->phase_saving) {
+            C->Phase[x] = S->State[x] & 1;
+        }
+        S->State[x] = UNSET;
+        S->Var[i] = UNSET;
+        if (x < C->next_var) {
+            C->next_var = x;
+        }
+        if (C->O != NULL) {
+            insert_order(C->O, x);
+        }
+    }
+    S->n = C->TrailLim[level];
+    C->qhead = S->n;
+    C->level = level;
+}
+
+// choose the next decision variable (0 if all the variables are assigned)
+static int pick_branch_var(cdcl_t* C)
+{
+    if (C->O != NULL) {
+        int x;
+        do {
+            x = pop_order(C->O);
+        } while (x != 0 && C->S->State[x] != UNSET);
+        return x;
+    }
+    while (C->next_var <= C->F->nb_var && C->S->State[C->next_var] != UNSET) {
+        C->next_var++;
+    }
+    return C->next_var <= C->F->nb_var ? C->next_var : 0;
+}
+
+// add a clause at level 0
+// the literals that are false at level 0 are removed, and the clause is ignored if it is satisfied
+// returns 0 if the clause is false (the formula is then unsatisfiable)
+static int add_clause_level0(cdcl_t* C, int* lits, int size, int learnt)
+{
+    assert(C->level == 0);
+    int c[size + 1];
+    int n = 0;
+    for (int i = 0; i < size; i++) {
+        if (value(C, lits[i]) == TRUE) {
+            return 1;
+        }
+        if (value(C, lits[i]) == UNSET) {
+            c[n++] = lits[i];
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+    if (n == 1) {
+        assign(C, c[0], EOL);
+    } else {
+        int cr = add_clause(C, c, n, learnt);
+        CLAUSE(C->A, cr)->lbd = n;
+    }
+    return 1;
+}
+
+// add a clause coming from another solver (it may be deleted later, as learned clauses)
+// returns 0 if the formula is found unsatisfiable
+int import_clause(cdcl_t* C, int* lits, int size)
+{
+    C->nb_imported++;
+    return add_clause_level0(C, lits, size, 1);
+}
+
+// add a clause to the formula of the engine (it is never deleted), at level 0
+// the clause must not contain the same variable twice
+// returns 0 if the formula is found unsatisfiable
+int add_formula_clause(cdcl_t* C, int* lits, int size)
+{
+    if (!add_clause_level0(C, lits, size, 0)) {
+        C->unsat = 1;
+        return 0;
+    }
+    return 1;
+}
+
+// set the literals assumed by the next searches (they are decided before any other variable)
+void set_assumptions(cdcl_t* C, int* lits, int n)
+{
+    // the assumptions that are already true use a decision level without any assignment
+    if (C->F->nb_var + n > C->max_level) {
+        C->TrailLim = realloc(C->TrailLim, (C->F->nb_var + n + 1) * sizeof(int));
+        C->Stamp = realloc(C->Stamp, (C->F->nb_var + n + 1) * sizeof(int));
+        for (int l = C->max_level + 1; l <= C->F->nb_var + n; l++) {
+            C->Stamp[l] = 0;
+        }
+        C->max_level = C->F->nb_var + n;
+    }
+    C->Assumptions = realloc(C->Assumptions, (n + 1) * sizeof(int));
+    C->Failed = realloc(C->Failed, (n + 1) * sizeof(int));
+    memcpy(C->Assumptions, lits, n * sizeof(int));
+    C->nb_assumptions = n;
+}
+
+////////////
+// lookahead
+
+// propagate the pending assignments (of the current level)
+// returns 0 if there is a conflict (the formula is then unsatisfiable if the level is 0)
+int propagate_pending(cdcl_t* C)
+{
+    if (propagate(C) != EOL) {
+        if (C->level == 0) {
+            C->unsat = 1;
+        }
+        return 0;
+    }
+    return 1;
+}
+
+// assign a literal at a new decision level, and propagate it (after the pending assignments)
+// returns 0 if there is a conflict: nothing is then assigned at the new level
+int push_decision(cdcl_t* C, int lit)
+{
+    if (!propagate_pending(C)) {
+        return 0;
+    }
+    assert(value(C, lit) == UNSET);
+    C->TrailLim[C->level++] = C->S->n;
+    assign(C, lit, EOL);
+    if (propagate(C) != EOL) {
+        cancel_until(C, C->level - 1);
+        return 0;
+    }
+    return 1;
+}
+
+// remove the assignments of the last decision level
+void pop_decision(cdcl_t* C)
+{
+    assert(C->level > 0);
+    cancel_until(C, C->level - 1);
+}
+
+///////////////////////////////
+// reducing the learned clauses
+
+// is a clause the reason of an assignment? (it cannot be deleted)
+static int locked(cdcl_t* C, int cr)
+{
+    int lit = CLAUSE(C->A, cr)->lits[0];
+    return value(C, lit) == TRUE && C->Reason[VARIABLE(lit)] == cr;
+}
+
+// learned clause, with the data used to sort them
+typedef struct {
+    int cr;
+    int lbd;
+    float activity;
+} learnt_t;
+
+// order of the learned clauses for deletion: highest LBD first, then lowest activity first
+static int compare_learnts(const void* a, const void* b)
+{
+    const learnt_t* p = a;
+    const learnt_t* q = b;
+    if (p->lbd != q->lbd) {
+        return q->lbd - p->lbd;
+    }
+    return (p->activity > q->activity) - (p->activity < q->activity);
+}
+
+// move a clause to a new arena (if it wasn't already moved) and return its new reference
+static int relocate(arena_t* From, arena_t* To, int cr)
+{
+    clause_t* c = CLAUSE(From, cr);
+    if (!c->moved) {
+        int new_cr = alloc_clause(To, c->lits, c->size, c->learnt);
+        CLAUSE(To, new_cr)->lbd = c->lbd;
+        CLAUSE(To, new_cr)->activity = c->activity;
+        c->moved = 1;
+        c->lits[0] = new_cr;
+    }
+    return c->lits[0];
+}
+
+// compact the arena: the clauses that weren't deleted are moved to a new arena, and all the
+// references (reasons, watchers, learned clauses) are updated
+// the clauses are moved in the order of the watch lists, so that clauses watched by the same
+// literal end up close to each other
+static void collect_garbage(cdcl_t* C)
+{
+    arena_t* From = C->A;
+    arena_t* To = new_arena(From->size - From->wasted);
+    sol_t* S = C->S;
+    for (int i = 0; i < S->n; i++) {
+        int x = S->Var[i];
+        if (C->Reason[x] != EOL) {
+            C->Reason[x] = relocate(From, To, C->Reason[x]);
+        }
+    }
+    for (int lit = 0; lit < C->W->nb_lit; lit++) {
+        for (int i = 0; i < C->W->Size[lit]; i++) {
+            C->W->Watch[lit][i].cl = relocate(From, To, C->W->Watch[lit][i].cl);
+        }
+    }
+    for (int i = 0; i < C->nb_learnts; i++) {
+        C->Learnts[i] = relocate(From, To, C->Learnts[i]);
+    }
+    LOG(2, "< < <  garbage collection: %d word(s) -> %d word(s)\n", From->size, To->size);
+    free_arena(From);
+    C->A = To;
+    // the clauses have moved: the vivification starts again from the first one
+    C->vivify_next = 0;
+}
+
+// delete the least useful half of the learned clauses
+// clauses that are reasons, binary clauses and "glue" clauses (LBD <= 2) are always kept
+static void reduce_learnts(cdcl_t* C)
+{
+    int n = C->nb_learnts;
+    learnt_t* L = malloc((n + 1) * sizeof(learnt_t));
+    for (int i = 0; i < n; i++) {
+        clause_t* c = CLAUSE(C->A, C->Learnts[i]);
+        L[i].cr = C->Learnts[i];
+        L[i].lbd = c->lbd;
+        L[i].activity = c->activity;
+    }
+    qsort(L, n, sizeof(learnt_t), compare_learnts);
+    int nb_deleted = 0;
+    for (int i = 0; i < n && nb_deleted < n / 2; i++) {
+        clause_t* c = CLAUSE(C->A, L[i].cr);
+        if (c->lbd > 2 && c->size > 2 && !locked(C, L[i].cr)) {
+            delete_clause(C->A, L[i].cr);
+            nb_deleted++;
+        }
+    }
+    free(L);
+
+    // remove the deleted clauses from the list of learned clauses and from the watch lists
+    int i, j;
+    for (i = j = 0; i < n; i++) {
+        if (!CLAUSE(C->A, C->Learnts[i])->deleted) {
+            C->Learnts[j++] = C->Learnts[i];
+        }
+    }
+    C->nb_learnts = j;
+    for (int lit = 0; lit < C->W->nb_lit; lit++) {
+        watcher_t* ws = C->W->Watch[lit];
+        for (i = j = 0; i < C->W->Size[lit]; i++) {
+            if (!CLAUSE(C->A, ws[i].cl)->deleted) {
+                ws[j++] = ws[i];
+            }
+        }
+        C->W->Size[lit] = j;
+    }
+    C->nb_reductions++;
+    C->nb_deleted += nb_deleted;
+    LOG(2, "< < <  reduction %ld: %d learned clause(s) deleted, %d kept\n", C->nb_reductions,
+        nb_deleted, C->nb_learnts);
+
+    // compact the arena when more than 20% of the memory is wasted
+    if (5 * C->A->wasted > C->A->size) {
+        collect_garbage(C);
+    }
+}
+
+////////////////
+// vivification
+
+// remove the two watchers of a clause
+static void detach_clause(cdcl_t* C, int cr)
+{
+    for (int k = 0; k < 2; k++) {
+        int lit = CLAUSE(C->A, cr)->lits[k];
+        watcher_t* ws = C->W->Watch[lit];
+        int i = 0;
+        while (ws[i].cl != cr) {
+            i++;
+        }
+        ws[i] = ws[--C->W->Size[lit]];
+    }
+}
+
+// vivify a clause (at level 0, the clause is neither a reason nor satisfied)
+// returns 0 if the formula is found unsatisfiable
+static int vivify_clause(cdcl_t* C, int cr)
+{
+    clause_t* c = CLAUSE(C->A, cr);
+    int size = c->size;
+    int Lits[size];
+    memcpy(Lits, c->lits, size * sizeof(int));
+    detach_clause(C, cr);
+    c->vivified = 1;
+
+    // the shortened clause is stored in Lits[0 .. n-1]
+    int n = 0;
+    int phase_saving = C->phase_saving;
+    C->phase_saving = 0; // the saved polarities come from the search
+    long props = C->nb_propagations;
+    for (int i = 0; i < size; i++) {
+        int lit = Lits[i];
+        if (value(C, lit) == FALSE) {
+            continue; // implied by the negations of the previous literals
+        }
+        Lits[n++] = lit;
+        if (value(C, lit) == TRUE || i == size - 1) {
+            break; // implied by the negations of the previous literals
+        }
+        C->TrailLim[C->level++] = C->S->n;
+        assign(C, lit ^ 1, EOL);
+        if (propagate(C) != EOL) {
+            break;
+        }
+    }
+    cancel_until(C, 0);
+    C->phase_saving = phase_saving;
+    C->vivify_props += C->nb_propagations - props;
+
+    c = CLAUSE(C->A, cr);
+    if (n == size) {
+        add_watcher(C->W, c->lits[0], cr, c->lits[1]);
+        add_watcher(C->W, c->lits[1], cr, c->lits[0]);
+        return 1;
+    }
+    C->nb_vivified++;
+    C->nb_vivified_lits += size - n;
+    int learnt = c->learnt;
+    int lbd = c->lbd < n ? c->lbd : n;
+    float activity = c->activity;
+    delete_clause(C->A, cr);
+    if (n == 1) {
+        assign(C, Lits[0], EOL);
+        if (propagate(C) != EOL) {
+            C->unsat = 1;
+            return 0;
+        }
+        return 1;
+    }
+    int new_cr = add_clause(C, Lits, n, learnt);
+    c = CLAUSE(C->A, new_cr);
+    c->vivified = 1;
+    c->lbd = lbd;
+    c->activity = activity;
+    return 1;
+}
+
+// vivify the clauses of the arena (from the last one vivified), within the budget of propagations
+// returns 0 if the formula is found unsatisfiable
+static int vivify(cdcl_t* C)
+{
+    long budget = (C->nb_propagations - C->vivify_props) / VIVIFY_SHARE - C->vivify_props;
+    long start = C->vivify_props;
+    long nb_vivified = C->nb_vivified;
+    int ok = 1;
+    while (ok && C->vivify_props - start < budget && C->vivify_next < C->A->size) {
+        int cr = C->vivify_next;
+        clause_t* c = CLAUSE(C->A, cr);
+        C->vivify_next += CLAUSE_WORDS(c->size);
+        if (c->deleted || c->vivified || c->size <= 2 || locked(C, cr)) {
+            continue;
+        }
+        int k = 0;
+        while (k < (int)c->size && value(C, c->lits[k]) != TRUE) {
+            k++;
+        }
+        if (k < (int)c->size) {
+            continue; // satisfied at level 0
+        }
+        ok = vivify_clause(C, cr);
+    }
+    if (C->vivify_next >= C->A->size) {
+        C->vivify_next = 0;
+    }
+
+    // the replaced learned clauses are removed from the list
+    int i, j;
+    for (i = j = 0; i < C->nb_learnts; i++) {
+        if (!CLAUSE(C->A, C->Learnts[i])->deleted) {
+            C->Learnts[j++] = C->Learnts[i];
+        }
+    }
+    C->nb_learnts = j;
+    LOG(2, "< < <  vivification: %ld clause(s) shortened\n", C->nb_vivified - nb_vivified);
+    return ok;
+}
+
+///////////
+// restarts
+
+// i-th element (starting from 0) of the Luby sequence: 1 1 2 1 1 2 4 1 1 2 1 1 2 4 8 1 ...
+static long luby(long i)
+{
+    // find the finite subsequence that contains index i, and its size
+    long size = 1;
+    int seq = 0;
+    while (size < i + 1) {
+        seq++;
+        size = 2 * size + 1;
+    }
+    // go down in the subsequences until i is the last element of one of them
+    while (size - 1 != i) {
+        size = (size - 1) / 2;
+        seq--;
+        i = i % size;
+    }
+    return 1L << seq;
+}
+
+// update the restart policy after a conflict, and tell if we should restart
+static int need_restart(cdcl_t* C)
+{
+    C->restart_conflicts++;
+    switch (C->restart) {
+    case RESTART_LUBY:
+        return C->restart_conflicts >= C->luby_unit * luby(C->nb_restarts);
+    case RESTART_EMA:
+        // (during the first conflicts, the averages are plain averages)
+        C->ema_fast += (C->level - C->ema_fast) / (C->nb_conflicts < 32 ? C->nb_conflicts : 32);
+        C->ema_slow += (C->level - C->ema_slow) / (C->nb_conflicts < 4096 ? C->nb_conflicts : 4096);
+        // the last conflicts happened much deeper than usual: we are probably stuck in a bad
+        // part of the search space
+        return C->restart_conflicts >= 50 && C->ema_fast > 1.1 * C->ema_slow;
+    default:
+        return 0;
+    }
+}
+
+/////////////
+// main loop
+
+// look for a solution, returns 1 if the formula is satisfiable and 0 otherwise
+// returns -1 if the search was interrupted (C->max_conflicts or C->Stop), after going back to level 0
+int run_cdcl(cdcl_t* C)
+{
+    C->nb_failed = 0;
+    if (C->unsat) {
+        return 0;
+    }
+    // the engine may be at any level after a previous search
+    cancel_until(C, 0);
+    int restart = 0;
+    while (1) {
+        int confl = propagate(C);
+        if (confl != EOL) {
+            C->nb_conflicts++;
+            if (C->level == 0) {
+                C->unsat = 1;
+                return 0;
+            }
+            restart = restart || need_restart(C);
+            int blevel;
+            int lbd;
+            int size = analyze(C, confl, &blevel, &lbd);
+            if (C->O != NULL) {
+                decay_order(C->O);
+            }
+            C->cla_inc /= CLAUSE_DECAY;
+            LOG(2, "< < <  conflict %ld: learned clause of size %d, backjump from %d to %d\n",
+                C->nb_conflicts, size, C->level, blevel);
+            cancel_until(C, blevel);
+            if (size == 1) {
+                assign(C, C->Learnt[0], EOL);
+            } else {
+                int cr = add_clause(C, C->Learnt, size, 1);
+                CLAUSE(C->A, cr)->lbd = lbd;
+                assign(C, C->Learnt[0], cr);
+            }
+            C->nb_learnt++;
+            if (C->Share != NULL && size <= SHARE_SIZE) {
+                export_clause(C, C->Learnt, size);
+            }
+            if (C->nb_conflicts >= C->next_reduce) {
+                reduce_learnts(C);
+                C->next_reduce = C->nb_conflicts + REDUCE_FIRST + REDUCE_INC * C->nb_reductions;
+            }
+        } else if ((C->max_conflicts >= 0 && C->nb_conflicts >= C->max_conflicts)
+            || (C->Stop != NULL && __atomic_load_n(C->Stop, __ATOMIC_RELAXED))) {
+            cancel_until(C, 0);
+            return -1;
+        } else if (restart) {
+            LOG(2, "< < <  restart %ld after %ld conflict(s)\n", C->nb_restarts + 1,
+                C->restart_conflicts);
+            cancel_until(C, 0);
+            C->nb_restarts++;
+            C->restart_conflicts = 0;
+            restart = 0;
+            if (C->Share != NULL && !exchange_clauses(C)) {
+                C->unsat = 1;
+                return 0;
+            }
+            if (C->nb_conflicts >= C->next_vivify) {
+                C->next_vivify = C->nb_conflicts + VIVIFY_INTERVAL;
+                if (propagate(C) != EOL || !vivify(C)) {
+                    C->unsat = 1;
+                    return 0;
+                }
+            }
+        } else if (C->level < C->nb_assumptions) {
+            int p = C->Assumptions[C->level];
+            if (value(C, p) == FALSE) {
+                analyze_final(C, p);
+                return 0;
+            }
+            C->TrailLim[C->level++] = C->S->n;
+            if (value(C, p) == UNSET) {
+                C->nb_decisions++;
+                assign(C, p, EOL);
+            }
+        } else {
+            int x = pick_branch_var(C);
+            if (x == 0) {
+                return 1;
+            }
+            C->nb_decisions++;
+            C->TrailLim[C->level++] = C->S->n;
+            LOG(3, "> > >  decision %ld: %sX%d at level %d\n", C->nb_decisions,
+                C->Phase[x] ? "" : "¬", x, C->level);
+            assign(C, 2 * x + C->Phase[x], EOL);
+        }
+    }
+}
+
+// look for a solution with the CDCL algorithm
+int solve_cdcl(formula_t* F, sol_t* S, order_t* O)
+{
+    cdcl_t* C = new_cdcl(F, S, O);
+    int sat = run_cdcl(C);
+    LOG(1, "%ld decision(s), %ld conflict(s), %ld propagation(s), %ld learned clause(s)\n",
+        C->nb_decisions, C->nb_conflicts, C->nb_propagations, C->nb_learnt);
+    LOG(1, "%ld restart(s), %ld reduction(s) of the learned clauses (%ld deleted)\n",
+        C->nb_restarts, C->nb_reductions, C->nb_deleted);
+    LOG(1, "%ld clause(s) vivified, %ld literal(s) removed\n", C->nb_vivified,
+        C->nb_vivified_lits);
+    free_cdcl(C);
+    if (!sat) {
+        S->n = -1;
+    }
+    return sat;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
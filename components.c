@@ -0,0 +1,368 @@
+#include "sat.h"
+
+// Connected components.
+//
+// Two variables are connected when they appear in the same clause. Each connected component of
+// the formula can be solved independently of the others: the formula is satisfiable iff all its
+// components are, and a solution is the union of the solutions of the components.
+//
+// The components of the initial formula are solved in parallel (NB_THREADS threads) with the
+// CDCL engine. When a component is hard (the CDCL engine reaches its conflict budget), we branch
+// on its most active variable, simplify the formula, and look for components again: assigning
+// a variable often splits a component in several parts.
+
+// conflict budget of the CDCL engine before branching, doubled at each branching level
+#define SPLIT_CONFLICTS 1000
+// no more branching after this depth: the CDCL engine is run without budget
+#define SPLIT_DEPTH 8
+
+//////////////////////////
+// finding the components
+
+// find the representative of a variable in the union-find structure (with path halving)
+static int find(int* Parent, int x)
+{
+    while (Parent[x] != x) {
+        Parent[x] = Parent[Parent[x]];
+        x = Parent[x];
+    }
+    return x;
+}
+
+// compute the connected components of the formula
+// Comp (array of size nb_var+1) receives the component (0, 1, ...) of each variable, or EOL for
+// variables that don't appear in the formula. Returns the number of components.
+int find_components(formula_t* F, int* Comp)
+{
+    int* Parent = malloc((F->nb_var + 1) * sizeof(int));
+    int* Size = malloc((F->nb_var + 1) * sizeof(int));
+    for (int x = 0; x <= F->nb_var; x++) {
+        Parent[x] = x;
+        Size[x] = 1;
+        Comp[x] = EOL;
+    }
+
+    // all the variables of a clause are in the same component
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        if (F->Cl[cl] == F->Cl[cl + 1]) {
+            continue;
+        }
+        int r = find(Parent, VARIABLE(F->Lit[F->Cl[cl]]));
+        for (int i = F->Cl[cl] + 1; i < F->Cl[cl + 1]; i++) {
+            int s = find(Parent, VARIABLE(F->Lit[i]));
+            if (r == s) {
+                continue;
+            }
+            // union by size
+            if (Size[r] < Size[s]) {
+                int tmp = r;
+                r = s;
+                s = tmp;
+            }
+            Parent[s] = r;
+            Size[r] += Size[s];
+        }
+    }
+
+    // number the components
+    int nb_comp = 0;
+    for (int i = 0; i < F->nb_lit; i++) {
+        int x = VARIABLE(F->Lit[i]);
+        int r = find(Parent, x);
+        if (Comp[r] == EOL) {
+            Comp[r] = nb_comp++;
+        }
+        Comp[x] = Comp[r];
+    }
+    free(Parent);
+    free(Size);
+    return nb_comp;
+}
+
+// extract the formula of the c-th component, with variables numbered from 1
+// Map (array of size nb_var+1) receives the original number of each variable of the new formula
+formula_t* component_formula(formula_t* F, int* Comp, int c, int* Map)
+{
+    int* New = malloc((F->nb_var + 1) * sizeof(int)); // new number of the variables
+    int nb_var = 0;
+    int nb_cl = 0;
+    int nb_lit = 0;
+    for (int x = 1; x <= F->nb_var; x++) {
+        if (Comp[x] == c) {
+            New[x] = ++nb_var;
+            Map[nb_var] = x;
+        }
+    }
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        if (F->Cl[cl] < F->Cl[cl + 1] && Comp[VARIABLE(F->Lit[F->Cl[cl]])] == c) {
+            nb_cl++;
+            nb_lit += F->Cl[cl + 1] - F->Cl[cl];
+        }
+    }
+
+    formula_t* G = malloc(sizeof(formula_t));
+    G->nb_var = nb_var;
+    G->nb_cl = nb_cl;
+    G->nb_lit = nb_lit;
+    G->Lit = malloc((nb_lit + 1) * sizeof(int));
+    G->Cl = malloc((nb_cl + 1) * sizeof(int));
+    // the cardinality and XOR constraints are expanded before the components are split
+    G->nb_card = 0;
+    G->CardLit = malloc(sizeof(int));
+    G->Card = calloc(1, sizeof(int));
+    G->Bound = malloc(sizeof(int));
+    G->nb_xor = 0;
+    G->XorVar = malloc(sizeof(int));
+    G->Xor = calloc(1, sizeof(int));
+    G->Parity = malloc(sizeof(int));
+    G->VarName = malloc((nb_var + 1) * sizeof(char*));
+    for (int i = 0; i <= nb_var; i++) {
+        G->VarName[i] = NULL;
+    }
+    nb_cl = 0;
+    nb_lit = 0;
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        if (F->Cl[cl] < F->Cl[cl + 1] && Comp[VARIABLE(F->Lit[F->Cl[cl]])] == c) {
+            G->Cl[nb_cl++] = nb_lit;
+            for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+                int lit = F->Lit[i];
+                G->Lit[nb_lit++] = 2 * New[VARIABLE(lit)] + SIGN(lit);
+            }
+        }
+    }
+    G->Cl[nb_cl] = nb_lit;
+    free(New);
+    return G;
+}
+
+//////////////////////////
+// solving the components
+
+// copy the values of the variables of Sc into S, for the variables that are still unset in S
+// (variable x of Sc is variable Map[x] of S, or x itself if Map is NULL)
+static void copy_values(sol_t* S, sol_t* Sc, int nb_var, int* Map)
+{
+    for (int x = 1; x <= nb_var; x++) {
+        int y = Map == NULL ? x : Map[x];
+        if (Sc->State[x] != UNSET && S->State[y] == UNSET) {
+            S->State[y] = Sc->State[x];
+            S->Var[S->n++] = y;
+        }
+    }
+}
+
+// set all the unset variables to false
+static void complete_sol(sol_t* S, int nb_var)
+{
+    for (int x = 1; x <= nb_var; x++) {
+        if (S->State[x] == UNSET) {
+            S->State[x] = FALSE;
+            S->Var[S->n++] = x;
+        }
+    }
+}
+
+// copy a formula and add a unit clause to it
+formula_t* formula_with_unit(formula_t* F, int lit)
+{
+    formula_t* G = copy_formula(F);
+    G->Lit[G->nb_lit] = lit;
+    G->nb_lit++;
+    G->nb_cl++;
+    G->Cl = realloc(G->Cl, (G->nb_cl + 1) * sizeof(int));
+    G->Cl[G->nb_cl] = G->nb_lit;
+    return G;
+}
+
+static int solve_split(formula_t* F, sol_t* S, int depth, int* Stop);
+
+// solve a formula with the CDCL engine, and branch when it is too hard
+// the values of the variables of F are added to S (where they must be unset)
+// returns 1 (satisfiable), 0 (unsatisfiable) or -1 (interrupted)
+static int solve_branch(formula_t* F, sol_t* S, int depth, int* Stop)
+{
+    sol_t* Sc = new_sol(F->nb_var);
+    order_t* O = new_order(F->nb_var);
+    cdcl_t* C = new_cdcl(F, Sc, O);
+    C->Stop = Stop;
+    if (depth < SPLIT_DEPTH) {
+        C->max_conflicts = (long)SPLIT_CONFLICTS << depth;
+    }
+    int r = run_cdcl(C);
+    if (r == 1) {
+        copy_values(S, Sc, F->nb_var, NULL);
+    }
+
+    int x = 0;
+    int phase = 0;
+    if (r == -1 && (Stop == NULL || !__atomic_load_n(Stop, __ATOMIC_RELAXED))) {
+        // budget exhausted: the most active (unassigned) variable is a good candidate to split
+        // the formula
+        do {
+            x = pop_order(O);
+        } while (x != 0 && Sc->State[x] != UNSET);
+        phase = C->Phase[x];
+        if (x == 0) {
+            // every variable is fixed at level 0, without conflict: this is a solution
+            r = 1;
+            copy_values(S, Sc, F->nb_var, NULL);
+        }
+    }
+    free_cdcl(C);
+    free_order(O);
+
+    if (x != 0) {
+        LOG(2, "branching on X%d at depth %d\n", x, depth);
+        // NOTE: the learned clauses are lost, each branch starts again from F
+        r = 0;
+        for (int k = 0; k < 2 && r == 0; k++) {
+            formula_t* G = formula_with_unit(F, 2 * x + (phase ^ k));
+            sol_t* Sg = new_sol(G->nb_var);
+            r = preprocess(G, Sg);
+            if (r == 0) {
+                r = solve_split(G, Sg, depth + 1, Stop);
+            } else if (r == -1) {
+                r = 0;
+            }
+            if (r == 1) {
+                copy_values(S, Sg, F->nb_var, NULL);
+            }
+            free_sol(Sg);
+            free_formula(G);
+        }
+    }
+    free_sol(Sc);
+    return r;
+}
+
+// solve a formula by solving each of its components separately
+// the values of the variables of F are added to S (where they must be unset)
+static int solve_split(formula_t* F, sol_t* S, int depth, int* Stop)
+{
+    int* Comp = malloc((F->nb_var + 1) * sizeof(int));
+    int nb_comp = find_components(F, Comp);
+    int r = 1;
+    if (nb_comp == 1) {
+        r = solve_branch(F, S, depth, Stop);
+    } else {
+        LOG(2, "%d component(s) at depth %d\n", nb_comp, depth);
+        int* Map = malloc((F->nb_var + 1) * sizeof(int));
+        for (int c = 0; c < nb_comp && r == 1; c++) {
+            formula_t* G = component_formula(F, Comp, c, Map);
+            sol_t* Sg = new_sol(G->nb_var);
+            r = solve_branch(G, Sg, depth, Stop);
+            if (r == 1) {
+                copy_values(S, Sg, G->nb_var, Map);
+            }
+            free_sol(Sg);
+            free_formula(G);
+        }
+        free(Map);
+    }
+    free(Comp);
+    return r;
+}
+
+// shared data for the threads solving the components
+typedef struct {
+    formula_t* F;      // the whole formula
+    int* Comp;         // component of each variable
+    int nb_comp;       // number of components
+    int next;          // next component to solve
+    int stop;          // set when a component is unsatisfiable (or was not solved)
+    sol_t** Sol;       // solution of each component
+    int** Map;         // original numbers of the variables of each component
+    int* Nb_var;       // number of variables of each component
+    pthread_mutex_t lock;
+} pool_t;
+
+// thread function: solve components until there is none left
+static void* worker(void* arg)
+{
+    pool_t* P = arg;
+    while (1) {
+        pthread_mutex_lock(&P->lock);
+        int c = P->next++;
+        pthread_mutex_unlock(&P->lock);
+        if (c >= P->nb_comp || __atomic_load_n(&P->stop, __ATOMIC_RELAXED)) {
+            return NULL;
+        }
+        int* Map = malloc((P->F->nb_var + 1) * sizeof(int));
+        formula_t* G = component_formula(P->F, P->Comp, c, Map);
+        sol_t* Sg = new_sol(G->nb_var);
+        int r = solve_branch(G, Sg, 0, &P->stop);
+        if (r == 0) {
+            LOG(1, "component %d (%d variable(s)) is unsatisfiable\n", c, G->nb_var);
+        }
+        if (r != 1) {
+            // without the solution of this component, there is nothing to merge
+            __atomic_store_n(&P->stop, 1, __ATOMIC_RELAXED);
+        }
+        if (r == 1) {
+            P->Sol[c] = Sg;
+            P->Map[c] = Map;
+            P->Nb_var[c] = G->nb_var;
+        } else {
+            free_sol(Sg);
+            free(Map);
+        }
+        free_formula(G);
+    }
+}
+
+// look for a solution by solving the connected components of the formula separately, in parallel
+// S may already contain some (forced) values, for variables that don't appear in F
+int solve_components(formula_t* F, sol_t* S)
+{
+    // an empty clause belongs to no component
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        if (F->Cl[cl] == F->Cl[cl + 1]) {
+            S->n = -1;
+            return 0;
+        }
+    }
+    pool_t P;
+    P.F = F;
+    P.Comp = malloc((F->nb_var + 1) * sizeof(int));
+    P.nb_comp = find_components(F, P.Comp);
+    P.next = 0;
+    P.stop = 0;
+    P.Sol = calloc(P.nb_comp, sizeof(sol_t*));
+    P.Map = calloc(P.nb_comp, sizeof(int*));
+    P.Nb_var = calloc(P.nb_comp, sizeof(int));
+    pthread_mutex_init(&P.lock, NULL);
+    LOG(1, "The formula contains %d connected component(s)\n", P.nb_comp);
+
+    int nb_threads = NB_THREADS < P.nb_comp ? NB_THREADS : P.nb_comp;
+    pthread_t* Threads = malloc((nb_threads + 1) * sizeof(pthread_t));
+    for (int t = 0; t < nb_threads; t++) {
+        pthread_create(&Threads[t], NULL, worker, &P);
+    }
+    for (int t = 0; t < nb_threads; t++) {
+        pthread_join(Threads[t], NULL);
+    }
+
+    // merge the solutions of the components
+    int sat = !P.stop;
+    for (int c = 0; c < P.nb_comp; c++) {
+        if (sat) {
+            copy_values(S, P.Sol[c], P.Nb_var[c], P.Map[c]);
+        }
+        free_sol(P.Sol[c]);
+        free(P.Map[c]);
+    }
+    if (sat) {
+        complete_sol(S, F->nb_var);
+    } else {
+        S->n = -1;
+    }
+    pthread_mutex_destroy(&P.lock);
+    free(Threads);
+    free(P.Sol);
+    free(P.Map);
+    free(P.Nb_var);
+    free(P.Comp);
+    return sat;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
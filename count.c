@@ -0,0 +1,398 @@
+#include "sat.h"
+#include <stdint.h>
+
+// Model counting (#SAT).
+//
+// The number of models of a formula is computed recursively: unit clauses are propagated
+// (preprocess()), the variables that don't appear in the remaining clauses multiply the count by
+// 2, and the remaining formula is split in connected components whose counts are multiplied.
+// The count of a component is the sum of the counts of the component with a variable set to true
+// and to false (we branch on the variable with the most occurrences).
+//
+// The same components appear many times in the search, so their counts are kept in a cache,
+// where the key is the component itself (with its variables numbered from 1, as given by
+// component_formula()). The cache is emptied when its size reaches CACHE_MB megabytes. Small
+// components are counted by the exhaustive search.
+//
+// Counts are arbitrary precision natural numbers.
+
+// memory budget of the cache (in megabytes)
+#define CACHE_MB 512
+// components with at most this number of variables are counted with the exhaustive search
+#define COUNT_BRUTE_VAR 12
+
+//////////////////////////////////
+// arbitrary precision arithmetic
+
+// type for natural numbers: n digits in base 2^32, least significant first (no leading 0)
+typedef struct {
+    int n;
+    uint32_t* D;
+} bignum_t;
+
+// create a number from a 64 bits integer
+static bignum_t* new_bignum(unsigned long long v)
+{
+    bignum_t* A = malloc(sizeof(bignum_t));
+    A->D = malloc(2 * sizeof(uint32_t));
+    A->n = 0;
+    while (v > 0) {
+        A->D[A->n++] = (uint32_t)v;
+        v >>= 32;
+    }
+    return A;
+}
+
+static void free_bignum(bignum_t* A)
+{
+    if (A == NULL)
+        return;
+    free(A->D);
+    free(A);
+}
+
+static bignum_t* copy_bignum(bignum_t* A)
+{
+    bignum_t* B = malloc(sizeof(bignum_t));
+    B->n = A->n;
+    B->D = malloc((A->n + 1) * sizeof(uint32_t));
+    memcpy(B->D, A->D, A->n * sizeof(uint32_t));
+    return B;
+}
+
+// A + B
+static bignum_t* add_bignum(bignum_t* A, bignum_t* B)
+{
+    int n = A->n > B->n ? A->n : B->n;
+    bignum_t* C = malloc(sizeof(bignum_t));
+    C->D = malloc((n + 1) * sizeof(uint32_t));
+    uint64_t carry = 0;
+    for (int i = 0; i < n; i++) {
+        carry += (i < A->n ? A->D[i] : 0) + (uint64_t)(i < B->n ? B->D[i] : 0);
+        C->D[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    C->D[n] = (uint32_t)carry;
+    C->n = carry ? n + 1 : n;
+    return C;
+}
+
+// A * B
+static bignum_t* mul_bignum(bignum_t* A, bignum_t* B)
+{
+    bignum_t* C = malloc(sizeof(bignum_t));
+    C->D = calloc(A->n + B->n + 1, sizeof(uint32_t));
+    for (int i = 0; i < A->n; i++) {
+        uint64_t carry = 0;
+        for (int j = 0; j < B->n; j++) {
+            carry += (uint64_t)A->D[i] * B->D[j] + C->D[i + j];
+            C->D[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        C->D[i + B->n] = (uint32_t)carry;
+    }
+    C->n = A->n + B->n;
+    while (C->n > 0 && C->D[C->n - 1] == 0) {
+        C->n--;
+    }
+    return C;
+}
+
+// A * 2^k
+static bignum_t* shift_bignum(bignum_t* A, int k)
+{
+    bignum_t* C = malloc(sizeof(bignum_t));
+    int w = k / 32;
+    int b = k % 32;
+    C->D = calloc(A->n + w + 2, sizeof(uint32_t));
+    for (int i = 0; i < A->n; i++) {
+        uint64_t v = (uint64_t)A->D[i] << b;
+        C->D[i + w] |= (uint32_t)v;
+        C->D[i + w + 1] = (uint32_t)(v >> 32);
+    }
+    C->n = A->n == 0 ? 0 : A->n + w + 1;
+    while (C->n > 0 && C->D[C->n - 1] == 0) {
+        C->n--;
+    }
+    return C;
+}
+
+// decimal representation (to be freed)
+static char* bignum_to_string(bignum_t* A)
+{
+    // each digit in base 2^32 gives less than 10 decimal digits
+    char* s = malloc(10 * A->n + 2);
+    uint32_t* D = malloc((A->n + 1) * sizeof(uint32_t));
+    memcpy(D, A->D, A->n * sizeof(uint32_t));
+    int n = A->n;
+    int len = 0;
+    do {
+        // divide by 10^9, and write the remainder (backwards)
+        uint64_t r = 0;
+        for (int i = n - 1; i >= 0; i--) {
+            uint64_t v = (r << 32) | D[i];
+            D[i] = (uint32_t)(v / 1000000000);
+            r = v % 1000000000;
+        }
+        while (n > 0 && D[n - 1] == 0) {
+            n--;
+        }
+        for (int k = 0; k < 9 && (n > 0 || r > 0 || k == 0); k++) {
+            s[len++] = '0' + r % 10;
+            r /= 10;
+        }
+    } while (n > 0);
+    s[len] = '\0';
+    for (int i = 0; i < len / 2; i++) {
+        char c = s[i];
+        s[i] = s[len - 1 - i];
+        s[len - 1 - i] = c;
+    }
+    free(D);
+    return s;
+}
+
+////////////////////////
+// cache of components
+
+// type for the entries of the cache
+typedef struct entry_s {
+    unsigned hash;
+    int size;            // size of the key
+    int* Key;            // the component: nb_var, nb_cl, then its Cl and Lit arrays
+    bignum_t* Count;     // its number of models
+    struct entry_s* next;
+} entry_t;
+
+// type for the counter: the cache (a hash table), and statistics
+typedef struct {
+    entry_t** Table;
+    int nb_buckets;      // a power of 2
+    long nb_entries;
+    long memory;         // memory used by the entries (in bytes)
+    long nb_hits;
+    long nb_misses;
+    long nb_flushes;
+} counter_t;
+
+// the key of a component
+static int* component_key(formula_t* H, int* size)
+{
+    *size = 2 + (H->nb_cl + 1) + H->nb_lit;
+    int* Key = malloc(*size * sizeof(int));
+    Key[0] = H->nb_var;
+    Key[1] = H->nb_cl;
+    memcpy(Key + 2, H->Cl, (H->nb_cl + 1) * sizeof(int));
+    memcpy(Key + 3 + H->nb_cl, H->Lit, H->nb_lit * sizeof(int));
+    return Key;
+}
+
+// FNV-1a hash of a key
+static unsigned hash_key(int* Key, int size)
+{
+    unsigned h = 2166136261u;
+    for (int i = 0; i < size; i++) {
+        h = (h ^ (unsigned)Key[i]) * 16777619u;
+    }
+    return h;
+}
+
+// remove all the entries of the cache
+static void flush_cache(counter_t* K)
+{
+    for (int b = 0; b < K->nb_buckets; b++) {
+        entry_t* e = K->Table[b];
+        while (e != NULL) {
+            entry_t* next = e->next;
+            free(e->Key);
+            free_bignum(e->Count);
+            free(e);
+            e = next;
+        }
+        K->Table[b] = NULL;
+    }
+    K->nb_entries = 0;
+    K->memory = 0;
+}
+
+// count of a component in the cache, or NULL
+static bignum_t* find_cache(counter_t* K, int* Key, int size, unsigned hash)
+{
+    for (entry_t* e = K->Table[hash & (K->nb_buckets - 1)]; e != NULL; e = e->next) {
+        if (e->hash == hash && e->size == size && 0 == memcmp(e->Key, Key, size * sizeof(int))) {
+            return e->Count;
+        }
+    }
+    return NULL;
+}
+
+// add the count of a component to the cache (Key and Count belong to the cache afterwards)
+static void insert_cache(counter_t* K, int* Key, int size, unsigned hash, bignum_t* Count)
+{
+    long memory = sizeof(entry_t) + size * sizeof(int) + sizeof(bignum_t)
+        + (Count->n + 1) * sizeof(uint32_t);
+    if (K->memory + memory > (long)CACHE_MB << 20) {
+        LOG(2, "cache full (%ld entries), emptied\n", K->nb_entries);
+        flush_cache(K);
+        K->nb_flushes++;
+    }
+    if (K->nb_entries >= 2 * K->nb_buckets) {
+        // grow the table
+        entry_t** Table = calloc((size_t)2 * K->nb_buckets, sizeof(entry_t*));
+        for (int b = 0; b < K->nb_buckets; b++) {
+            entry_t* e = K->Table[b];
+            while (e != NULL) {
+                entry_t* next = e->next;
+                int nb = e->hash & (2 * K->nb_buckets - 1);
+                e->next = Table[nb];
+                Table[nb] = e;
+                e = next;
+            }
+        }
+        free(K->Table);
+        K->Table = Table;
+        K->nb_buckets *= 2;
+    }
+    entry_t* e = malloc(sizeof(entry_t));
+    e->hash = hash;
+    e->size = size;
+    e->Key = Key;
+    e->Count = Count;
+    e->next = K->Table[hash & (K->nb_buckets - 1)];
+    K->Table[hash & (K->nb_buckets - 1)] = e;
+    K->nb_entries++;
+    K->memory += memory;
+}
+
+/////////////
+// counting
+
+static bignum_t* count_formula(counter_t* K, formula_t* F, sol_t* S);
+
+// count the models of a connected component (all its variables appear in its clauses)
+static bignum_t* count_component(counter_t* K, formula_t* H)
+{
+    int size;
+    int* Key = component_key(H, &size);
+    unsigned hash = hash_key(Key, size);
+    bignum_t* N = find_cache(K, Key, size, hash);
+    if (N != NULL) {
+        K->nb_hits++;
+        free(Key);
+        return copy_bignum(N);
+    }
+    K->nb_misses++;
+
+    if (H->nb_var <= COUNT_BRUTE_VAR) {
+        sol_t* S = new_sol(H->nb_var);
+        unsigned long long n;
+        solve_brute(H, S, &n);
+        free_sol(S);
+        N = new_bignum(n);
+    } else {
+        // branch on the variable with the most occurrences
+        int* Occ = calloc(H->nb_var + 1, sizeof(int));
+        int x = 1;
+        for (int i = 0; i < H->nb_lit; i++) {
+            int y = VARIABLE(H->Lit[i]);
+            if (++Occ[y] > Occ[x]) {
+                x = y;
+            }
+        }
+        free(Occ);
+        N = new_bignum(0);
+        for (int s = 0; s < 2; s++) {
+            formula_t* G = formula_with_unit(H, 2 * x + s);
+            sol_t* Sg = new_sol(G->nb_var);
+            bignum_t* M = count_formula(K, G, Sg);
+            bignum_t* Sum = add_bignum(N, M);
+            free_bignum(N);
+            free_bignum(M);
+            N = Sum;
+            free_sol(Sg);
+            free_formula(G);
+        }
+    }
+    insert_cache(K, Key, size, hash, copy_bignum(N));
+    return N;
+}
+
+// count the models of a formula (without empty clause) over its nb_var variables, where the
+// variables set in S are fixed (F is simplified)
+static bignum_t* count_formula(counter_t* K, formula_t* F, sol_t* S)
+{
+    int r = preprocess(F, S);
+    if (r == -1) {
+        return new_bignum(0);
+    }
+    int* Comp = malloc((F->nb_var + 1) * sizeof(int));
+    int nb_comp = 0;
+    if (r == 1) {
+        // all the clauses are satisfied
+        for (int x = 0; x <= F->nb_var; x++) {
+            Comp[x] = EOL;
+        }
+    } else {
+        nb_comp = find_components(F, Comp);
+    }
+    // the unset variables that don't appear in the formula can take any value
+    int nb_free = 0;
+    for (int x = 1; x <= F->nb_var; x++) {
+        if (S->State[x] == UNSET && Comp[x] == EOL) {
+            nb_free++;
+        }
+    }
+    bignum_t* One = new_bignum(1);
+    bignum_t* N = shift_bignum(One, nb_free);
+    free_bignum(One);
+
+    int* Map = malloc((F->nb_var + 1) * sizeof(int));
+    for (int c = 0; c < nb_comp && N->n > 0; c++) {
+        formula_t* H = component_formula(F, Comp, c, Map);
+        bignum_t* M = count_component(K, H);
+        bignum_t* P = mul_bignum(N, M);
+        free_bignum(N);
+        free_bignum(M);
+        N = P;
+        free_formula(H);
+    }
+    free(Map);
+    free(Comp);
+    return N;
+}
+
+// count the models of a formula, where the variables set in S are fixed
+// returns the decimal representation of the number of models (to be freed)
+char* count_models(formula_t* F, sol_t* S)
+{
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        if (F->Cl[cl] == F->Cl[cl + 1]) {
+            char* s = malloc(2);
+            strcpy(s, "0");
+            return s;
+        }
+    }
+    counter_t K;
+    K.nb_buckets = 1024;
+    K.Table = calloc(K.nb_buckets, sizeof(entry_t*));
+    K.nb_entries = 0;
+    K.memory = 0;
+    K.nb_hits = 0;
+    K.nb_misses = 0;
+    K.nb_flushes = 0;
+
+    formula_t* G = copy_formula(F);
+    bignum_t* N = count_formula(&K, G, S);
+    char* s = bignum_to_string(N);
+    LOG(1, "%ld component(s) counted, %ld found in the cache (%ld entries, %ld kB, emptied %ld "
+           "time(s))\n",
+        K.nb_misses, K.nb_hits, K.nb_entries, K.memory >> 10, K.nb_flushes);
+
+    free_bignum(N);
+    free_formula(G);
+    flush_cache(&K);
+    free(K.Table);
+    return s;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
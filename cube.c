@@ -0,0 +1,469 @@
+#include "sat.h"
+
+// Cube and conquer.
+//
+// A lookahead splitter cuts the search space in cubes: partial assignments obtained by branching,
+// at each node, on the variable whose two literals both propagate many assignments. Each cube is
+// then solved by a CDCL engine where its literals are forced at level 0. The formula is
+// satisfiable iff one of the cubes is, and unsatisfiable once all the cubes are refuted.
+//
+// The cubes are solved by NB_THREADS threads, each with its own deque: a thread takes the last
+// cube of its deque, and when it is empty, steals the first cube of the deque of another thread.
+// A cube gets a conflict budget; when the budget is exhausted while fewer cubes are waiting than
+// there are threads, the cube is split again (its engine, with its learned clauses, is used for
+// the lookahead), into as many cubes as needed to keep all the threads busy.
+
+// number of cubes per thread produced by the initial split
+#define CUBES_PER_THREAD 4
+// number of conflicts between two attempts at splitting a cube
+#define CUBE_CONFLICTS 2000
+// number of candidate variables evaluated by the lookahead at each node
+#define LOOKAHEAD_VARS 32
+
+// type for cubes
+typedef struct {
+    int size;
+    int* Lits;
+} cube_t;
+
+// type for deques of cubes (the cubes are Cubes[first] up to Cubes[last-1])
+typedef struct {
+    cube_t* Cubes;
+    int first;
+    int last;
+    int cap;
+    pthread_mutex_t lock;
+} deque_t;
+
+// data shared by the threads
+typedef struct {
+    formula_t* F;
+    double* Weight;       // array of size nb_var+1: weight of each variable (choice of candidates)
+    int nb_threads;
+    deque_t* Deques;      // the deque of each thread
+    int queued;           // number of cubes in the deques
+    int pending;          // number of cubes in the deques or being solved
+    long pushed;          // number of cubes pushed so far (idle threads wait for it to change)
+    int stop;             // set when a cube is satisfiable
+    sol_t* Sol;           // its solution
+    int nb_refuted;       // statistics...
+    int nb_split;
+    pthread_mutex_t lock; // protects pending, pushed and Sol
+    pthread_cond_t wake;  // signaled when cubes are pushed, or when the search is over
+} conquer_t;
+
+// data of a thread
+typedef struct {
+    conquer_t* P;
+    int id;
+} worker_t;
+
+// state of the lookahead splitter
+typedef struct {
+    cdcl_t* C;        // engine where the literals of the cube being split are assigned
+    double* Weight;   // weight of each variable
+    cube_t* Base;     // cube being split
+    int* Path;        // literals assigned at each decision level, after the cube
+    int n;            // number of literals in Path
+    cube_t* Cubes;    // cubes found so far
+    int nb_cubes;
+    int cap;
+} splitter_t;
+
+//////////////////
+// deques of cubes
+
+// add cubes at the end of the deque of a thread
+static void push_cubes(conquer_t* P, int id, cube_t* Cubes, int nb_cubes)
+{
+    deque_t* D = &P->Deques[id];
+    pthread_mutex_lock(&D->lock);
+    if (D->last + nb_cubes > D->cap) {
+        memmove(D->Cubes, D->Cubes + D->first, (D->last - D->first) * sizeof(cube_t));
+        D->last -= D->first;
+        D->first = 0;
+        while (D->last + nb_cubes > D->cap) {
+            D->cap *= 2;
+        }
+        D->Cubes = realloc(D->Cubes, D->cap * sizeof(cube_t));
+    }
+    memcpy(D->Cubes + D->last, Cubes, nb_cubes * sizeof(cube_t));
+    D->last += nb_cubes;
+    __atomic_fetch_add(&P->queued, nb_cubes, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&D->lock);
+
+    pthread_mutex_lock(&P->lock);
+    P->pending += nb_cubes;
+    P->pushed += nb_cubes;
+    pthread_cond_broadcast(&P->wake);
+    pthread_mutex_unlock(&P->lock);
+}
+
+// take a cube from a deque, from its end (owner) or from its start (thief)
+// returns 0 if the deque is empty
+static int pop_cube(conquer_t* P, int id, int steal, cube_t* Cube)
+{
+    deque_t* D = &P->Deques[id];
+    int found = 0;
+    pthread_mutex_lock(&D->lock);
+    if (D->first < D->last) {
+        *Cube = steal ? D->Cubes[D->first++] : D->Cubes[--D->last];
+        if (D->first == D->last) {
+            D->first = D->last = 0;
+        }
+        __atomic_fetch_sub(&P->queued, 1, __ATOMIC_RELAXED);
+        found = 1;
+    }
+    pthread_mutex_unlock(&D->lock);
+    return found;
+}
+
+// take a cube from the deque of a thread, or steal one from the other threads
+static int take_cube(conquer_t* P, int id, cube_t* Cube)
+{
+    if (pop_cube(P, id, 0, Cube)) {
+        return 1;
+    }
+    for (int k = 1; k < P->nb_threads; k++) {
+        if (pop_cube(P, (id + k) % P->nb_threads, 1, Cube)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//////////////////////////
+// the lookahead splitter
+
+// add the current node to the cubes found by the splitter
+static void add_cube(splitter_t* L)
+{
+    if (L->nb_cubes == L->cap) {
+        L->cap *= 2;
+        L->Cubes = realloc(L->Cubes, L->cap * sizeof(cube_t));
+    }
+    cube_t* Cube = &L->Cubes[L->nb_cubes++];
+    Cube->size = L->Base->size + L->n;
+    Cube->Lits = malloc((Cube->size + 1) * sizeof(int));
+    memcpy(Cube->Lits, L->Base->Lits, L->Base->size * sizeof(int));
+    memcpy(Cube->Lits + L->Base->size, L->Path, L->n * sizeof(int));
+}
+
+// number of assignments propagated by a literal, or EOL if it fails
+static int probe(cdcl_t* C, int lit)
+{
+    int n = C->S->n;
+    if (!push_decision(C, lit)) {
+        return EOL;
+    }
+    n = C->S->n - n;
+    pop_decision(C);
+    return n;
+}
+
+// choose the branching variable of the current node: among the LOOKAHEAD_VARS unassigned
+// variables of highest weight, the one maximizing the product of the numbers of assignments
+// propagated by its two literals
+// the negations of the failed literals found along the way are assigned at new levels (and added
+// to the path)
+// returns the variable, 0 if all the variables are assigned, or EOL if the node is refuted
+static int choose_split_var(splitter_t* L)
+{
+    cdcl_t* C = L->C;
+    sol_t* S = C->S;
+    int Cand[LOOKAHEAD_VARS];
+    int nb_cand = 0;
+    for (int x = 1; x <= C->F->nb_var; x++) {
+        if (S->State[x] != UNSET) {
+            continue;
+        }
+        // insertion in the candidates, sorted by decreasing weight
+        int i = nb_cand < LOOKAHEAD_VARS ? nb_cand++ : LOOKAHEAD_VARS;
+        while (i > 0 && L->Weight[Cand[i - 1]] < L->Weight[x]) {
+            if (i < LOOKAHEAD_VARS) {
+                Cand[i] = Cand[i - 1];
+            }
+            i--;
+        }
+        if (i < LOOKAHEAD_VARS) {
+            Cand[i] = x;
+        }
+    }
+
+    int best = 0;
+    long best_score = -1;
+    for (int i = 0; i < nb_cand; i++) {
+        int x = Cand[i];
+        if (S->State[x] != UNSET) {
+            continue; // assigned because of a failed literal
+        }
+        int n[2];
+        for (int s = 0; s < 2; s++) {
+            n[s] = probe(C, 2 * x + s);
+            if (n[s] == EOL) {
+                // failed literal: its negation is implied
+                LOG(3, "failed literal %sX%d\n", s ? "" : "¬", x);
+                if (!push_decision(C, 2 * x + 1 - s)) {
+                    return EOL;
+                }
+                L->Path[L->n++] = 2 * x + 1 - s;
+                break;
+            }
+        }
+        if (S->State[x] != UNSET) {
+            continue;
+        }
+        long score = (long)n[0] * n[1] + n[0] + n[1];
+        if (score > best_score) {
+            best = x;
+            best_score = score;
+        }
+    }
+    if ((best == 0 && nb_cand > 0) || (best != 0 && S->State[best] != UNSET)) {
+        // all the candidates, or the best one, were assigned by later failed literals: look again
+        return choose_split_var(L);
+    }
+    return best;
+}
+
+// split the current node into cubes, down to the given depth
+static void split(splitter_t* L, int depth)
+{
+    int n = L->n;
+    int x = depth > 0 ? choose_split_var(L) : 0;
+    if (x == 0) {
+        add_cube(L);
+    } else if (x != EOL) {
+        for (int s = 0; s < 2; s++) {
+            int lit = 2 * x + s;
+            if (push_decision(L->C, lit)) {
+                L->Path[L->n++] = lit;
+                split(L, depth - 1);
+                pop_decision(L->C);
+                L->n--;
+            }
+        }
+    }
+    // remove the literals implied by failed literals
+    while (L->n > n) {
+        pop_decision(L->C);
+        L->n--;
+    }
+}
+
+// split a cube (whose literals are assigned at level 0 in C) into at most 2^depth cubes
+// returns the number of cubes, stored in *Cubes (0 if the cube is refuted)
+static int split_cube(cdcl_t* C, double* Weight, cube_t* Base, int depth, cube_t** Cubes)
+{
+    assert(C->level == 0);
+    splitter_t L;
+    L.C = C;
+    L.Weight = Weight;
+    L.Base = Base;
+    L.Path = malloc((C->F->nb_var + 1) * sizeof(int));
+    L.n = 0;
+    L.cap = 16;
+    L.nb_cubes = 0;
+    L.Cubes = malloc(L.cap * sizeof(cube_t));
+    split(&L, depth);
+    free(L.Path);
+    *Cubes = L.Cubes;
+    return L.nb_cubes;
+}
+
+///////////////////////
+// solving the cubes
+
+// solve a cube with a CDCL engine, and split it when it is hard and threads are idle
+static void solve_cube(conquer_t* P, int id, cube_t* Cube)
+{
+    formula_t* F = P->F;
+    sol_t* S = new_sol(F->nb_var);
+    order_t* O = new_order(F->nb_var);
+    cdcl_t* C = new_cdcl(F, S, O);
+    C->Stop = &P->stop;
+    int r = -1;
+    for (int i = 0; i < Cube->size && r == -1; i++) {
+        if (!import_clause(C, &Cube->Lits[i], 1)) {
+            r = 0;
+        }
+    }
+    C->max_conflicts = CUBE_CONFLICTS;
+    while (r == -1) {
+        r = run_cdcl(C);
+        if (r != -1 || __atomic_load_n(&P->stop, __ATOMIC_RELAXED)) {
+            break;
+        }
+        int missing = P->nb_threads - __atomic_load_n(&P->queued, __ATOMIC_RELAXED);
+        if (missing > 0) {
+            // enough cubes for this thread and the idle ones
+            int depth = 1;
+            while ((1 << depth) < missing + 1) {
+                depth++;
+            }
+            cube_t* Cubes;
+            int nb_cubes = split_cube(C, P->Weight, Cube, depth, &Cubes);
+            LOG(2, "thread %d: cube of size %d split into %d cube(s)\n", id, Cube->size,
+                nb_cubes);
+            __atomic_fetch_add(&P->nb_split, 1, __ATOMIC_RELAXED);
+            if (nb_cubes > 0) {
+                push_cubes(P, id, Cubes, nb_cubes);
+            } else {
+                r = 0;
+            }
+            free(Cubes);
+            break;
+        }
+        C->max_conflicts = C->nb_conflicts + CUBE_CONFLICTS;
+    }
+    free_cdcl(C);
+    free_order(O);
+    free(Cube->Lits);
+
+    if (r == 0) {
+        __atomic_fetch_add(&P->nb_refuted, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_lock(&P->lock);
+    if (r == 1 && P->Sol == NULL) {
+        LOG(1, "thread %d: a cube of size %d is satisfiable\n", id, Cube->size);
+        P->Sol = S;
+        S = NULL;
+        __atomic_store_n(&P->stop, 1, __ATOMIC_RELAXED);
+    }
+    P->pending--;
+    if (P->stop || P->pending == 0) {
+        pthread_cond_broadcast(&P->wake);
+    }
+    pthread_mutex_unlock(&P->lock);
+    free_sol(S);
+}
+
+// thread function: solve cubes until a solution is found or all the cubes are refuted
+static void* worker(void* arg)
+{
+    worker_t* T = arg;
+    conquer_t* P = T->P;
+    while (1) {
+        pthread_mutex_lock(&P->lock);
+        long pushed = P->pushed;
+        int done = P->stop || P->pending == 0;
+        pthread_mutex_unlock(&P->lock);
+        if (done) {
+            return NULL;
+        }
+        cube_t Cube;
+        if (take_cube(P, T->id, &Cube)) {
+            solve_cube(P, T->id, &Cube);
+            continue;
+        }
+        // no cube for now: wait for new ones (or for the end of the search)
+        pthread_mutex_lock(&P->lock);
+        while (P->pushed == pushed && !P->stop && P->pending > 0) {
+            pthread_cond_wait(&P->wake, &P->lock);
+        }
+        pthread_mutex_unlock(&P->lock);
+    }
+}
+
+// look for a solution by splitting the formula in cubes, solved by NB_THREADS threads
+// S may already contain some values, for variables that don't appear in F
+int solve_cubes(formula_t* F, sol_t* S)
+{
+    conquer_t P;
+    int n = NB_THREADS;
+    P.F = F;
+    P.nb_threads = n;
+    P.queued = 0;
+    P.pending = 0;
+    P.pushed = 0;
+    P.stop = 0;
+    P.Sol = NULL;
+    P.nb_refuted = 0;
+    P.nb_split = 0;
+    pthread_mutex_init(&P.lock, NULL);
+    pthread_cond_init(&P.wake, NULL);
+    P.Deques = malloc(n * sizeof(deque_t));
+    for (int t = 0; t < n; t++) {
+        P.Deques[t].cap = 16;
+        P.Deques[t].Cubes = malloc(P.Deques[t].cap * sizeof(cube_t));
+        P.Deques[t].first = 0;
+        P.Deques[t].last = 0;
+        pthread_mutex_init(&P.Deques[t].lock, NULL);
+    }
+
+    // the variables in many short clauses are the preferred candidates of the lookahead
+    P.Weight = calloc(F->nb_var + 1, sizeof(double));
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        int size = F->Cl[cl + 1] - F->Cl[cl];
+        for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+            P.Weight[VARIABLE(F->Lit[i])] += 1.0 / (1 << (size < 16 ? size : 16));
+        }
+    }
+
+    // initial split, from the empty cube
+    sol_t* S0 = new_sol(F->nb_var);
+    cdcl_t* C = new_cdcl(F, S0, NULL);
+    C->max_conflicts = 0; // only propagate the unit clauses: returns 0 (refuted) or -1
+    int nb_cubes = 0;
+    cube_t* Cubes = NULL;
+    if (run_cdcl(C) == -1) {
+        int none[1];
+        cube_t Empty = { 0, none };
+        int depth = 1;
+        while ((1 << depth) < CUBES_PER_THREAD * n) {
+            depth++;
+        }
+        nb_cubes = split_cube(C, P.Weight, &Empty, depth, &Cubes);
+    }
+    free_cdcl(C);
+    free_sol(S0);
+    LOG(1, "%d initial cube(s)\n", nb_cubes);
+    for (int i = 0; i < nb_cubes; i++) {
+        push_cubes(&P, i % n, &Cubes[i], 1);
+    }
+    free(Cubes);
+
+    worker_t* T = malloc(n * sizeof(worker_t));
+    pthread_t* Threads = malloc(n * sizeof(pthread_t));
+    for (int t = 0; t < n; t++) {
+        T[t].P = &P;
+        T[t].id = t;
+        pthread_create(&Threads[t], NULL, worker, &T[t]);
+    }
+    for (int t = 0; t < n; t++) {
+        pthread_join(Threads[t], NULL);
+    }
+    LOG(1, "%d cube(s) refuted, %d split\n", P.nb_refuted, P.nb_split);
+
+    int sat = P.Sol != NULL;
+    if (sat) {
+        for (int x = 1; x <= F->nb_var; x++) {
+            if (S->State[x] == UNSET) {
+                S->State[x] = P.Sol->State[x];
+                S->Var[S->n++] = x;
+            }
+        }
+        free_sol(P.Sol);
+    } else {
+        S->n = -1;
+    }
+
+    // cubes left when a solution was found
+    for (int t = 0; t < n; t++) {
+        deque_t* D = &P.Deques[t];
+        for (int i = D->first; i < D->last; i++) {
+            free(D->Cubes[i].Lits);
+        }
+        free(D->Cubes);
+        pthread_mutex_destroy(&D->lock);
+    }
+    free(P.Deques);
+    free(P.Weight);
+    pthread_mutex_destroy(&P.lock);
+    pthread_cond_destroy(&P.wake);
+    free(T);
+    free(Threads);
+    return sat;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
@@ -0,0 +1,534 @@
+// mmap() and friends are POSIX, not C99
+#define _POSIX_C_SOURCE 200809L
+
+#include "sat.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Fast DIMACS loader.
+//
+// The file is mapped in memory and parsed in place with a hand-rolled integer scanner (no line
+// buffer, so no limit on the length of lines). The sizes given by the "p cnf" header are used to
+// preallocate the arrays. Big files are cut in chunks (at line boundaries), parsed by several
+// threads, and the chunks are then merged into a single formula.
+//
+// As for parse_formula(), a clause ends with a 0 or at the end of its line, and comments of the
+// form "c NAME -> IDX" give the names of variables. A line starting with '%' ends the formula
+// (SATLIB benchmarks end with "%\n0\n"). A line "l1 ... ln <= k" (or ">= k") is a cardinality
+// constraint (see cards.c), and a line "x l1 ... ln 0" is a XOR constraint (see gauss.c).
+
+// files smaller than this are parsed by a single thread
+#define CHUNK_MIN (1 << 20)
+// maximum number of chunks
+#define CHUNK_MAX 64
+
+// type for a chunk of the file, and the clauses parsed from it
+typedef struct {
+    const char* start; // first character of the chunk
+    const char* end;   // end of the chunk (just after a newline, or end of file)
+    int* Lit;          // literals of the chunk
+    int nb_lit;
+    int size_Lit;
+    int* Cl;           // start of each clause in Lit (there is no final sentinel)
+    int nb_cl;
+    int size_Cl;
+    int* CardLit;      // literals of the cardinality constraints of the chunk
+    int nb_card_lit;
+    int size_CardLit;
+    int* Card;         // start of each constraint in CardLit (there is no final sentinel)
+    int* Bound;        // bound of each constraint
+    int nb_card;
+    int size_Card;
+    int* XorVar;       // variables of the XOR constraints of the chunk
+    int nb_xor_var;
+    int size_XorVar;
+    int* Xor;          // start of each constraint in XorVar (there is no final sentinel)
+    int* Parity;       // parity of each constraint
+    int nb_xor;
+    int size_Xor;
+    int nb_var;        // largest variable seen in the chunk
+    const char** Name; // comment lines of the chunk (they may give names of variables)
+    int nb_name;
+    int size_Name;
+    int eof;           // set when a '%' line was found: the following chunks are ignored
+    int error;         // set when an unexpected character was found
+} chunk_t;
+
+// number of digits of a positive integer
+static int nb_digits(int n)
+{
+    int d = 1;
+    while (n >= 10) {
+        n /= 10;
+        d++;
+    }
+    return d;
+}
+
+// add a literal to a chunk
+static inline void push_lit(chunk_t* K, int lit)
+{
+    if (K->nb_lit == K->size_Lit) {
+        K->size_Lit += K->size_Lit / 2 + 16;
+        K->Lit = realloc(K->Lit, K->size_Lit * sizeof(int));
+    }
+    K->Lit[K->nb_lit++] = lit;
+}
+
+// add a clause (starting at index start of K->Lit) to a chunk
+static inline void push_clause(chunk_t* K, int start)
+{
+    if (K->nb_cl == K->size_Cl) {
+        K->size_Cl += K->size_Cl / 2 + 16;
+        K->Cl = realloc(K->Cl, K->size_Cl * sizeof(int));
+    }
+    K->Cl[K->nb_cl++] = start;
+}
+
+// add a cardinality constraint (whose literals start at index start of K->Lit) to a chunk, and
+// remove its literals from K->Lit
+// p points to the "<=" or ">=" operator, and the end of the bound is returned
+static const char* push_card(chunk_t* K, int start, const char* p, const char* end)
+{
+    int at_least = *p == '>';
+    p += 2;
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    int neg = p < end && *p == '-';
+    p += neg;
+    int bound = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        bound = 10 * bound + (*p - '0');
+        p++;
+    }
+    bound = neg ? -bound : bound;
+    int size = K->nb_lit - start;
+    if (K->nb_card == K->size_Card) {
+        K->size_Card = 2 * K->size_Card + 16;
+        K->Card = realloc(K->Card, K->size_Card * sizeof(int));
+        K->Bound = realloc(K->Bound, K->size_Card * sizeof(int));
+    }
+    while (K->nb_card_lit + size > K->size_CardLit) {
+        K->size_CardLit = 2 * K->size_CardLit + 16;
+        K->CardLit = realloc(K->CardLit, K->size_CardLit * sizeof(int));
+    }
+    // at least k literals are true iff at most n-k of their negations are true
+    K->Card[K->nb_card] = K->nb_card_lit;
+    K->Bound[K->nb_card++] = at_least ? size - bound : bound;
+    for (int i = start; i < K->nb_lit; i++) {
+        K->CardLit[K->nb_card_lit++] = at_least ? K->Lit[i] ^ 1 : K->Lit[i];
+    }
+    K->nb_lit = start;
+    return p;
+}
+
+// add a XOR constraint (whose literals start at index start of K->Lit) to a chunk, and remove
+// its literals from K->Lit
+static void push_xor(chunk_t* K, int start)
+{
+    int size = K->nb_lit - start;
+    if (K->nb_xor == K->size_Xor) {
+        K->size_Xor = 2 * K->size_Xor + 16;
+        K->Xor = realloc(K->Xor, K->size_Xor * sizeof(int));
+        K->Parity = realloc(K->Parity, K->size_Xor * sizeof(int));
+    }
+    while (K->nb_xor_var + size > K->size_XorVar) {
+        K->size_XorVar = 2 * K->size_XorVar + 16;
+        K->XorVar = realloc(K->XorVar, K->size_XorVar * sizeof(int));
+    }
+    // a negative literal flips the parity
+    K->Xor[K->nb_xor] = K->nb_xor_var;
+    K->Parity[K->nb_xor] = 1;
+    for (int i = start; i < K->nb_lit; i++) {
+        K->XorVar[K->nb_xor_var++] = VARIABLE(K->Lit[i]);
+        K->Parity[K->nb_xor] ^= 1 - SIGN(K->Lit[i]);
+    }
+    K->nb_xor++;
+    K->nb_lit = start;
+}
+
+// skip to the beginning of the next line
+static inline const char* next_line(const char* p, const char* end)
+{
+    const char* nl = memchr(p, '\n', end - p);
+    return nl == NULL ? end : nl + 1;
+}
+
+// parse the clauses of a chunk
+static void* parse_chunk(void* arg)
+{
+    chunk_t* K = arg;
+    const char* p = K->start;
+    const char* end = K->end;
+    while (p < end) {
+        // beginning of a line
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+            p++;
+        }
+        if (p == end) {
+            break;
+        }
+        if (*p == 'c') {
+            // the names are only parsed after merging the chunks, we only record the line
+            if (K->nb_name == K->size_Name) {
+                K->size_Name = 2 * K->size_Name + 16;
+                K->Name = realloc(K->Name, K->size_Name * sizeof(char*));
+            }
+            K->Name[K->nb_name++] = p + 1;
+            p = next_line(p, end);
+            continue;
+        }
+        if (*p == '%') {
+            K->eof = 1;
+            break;
+        }
+        int is_xor = *p == 'x';
+        p += is_xor;
+        if (!is_xor && *p != '-' && (*p < '0' || *p > '9')) {
+            // header, empty line or unknown line
+            p = next_line(p, end);
+            continue;
+        }
+
+        // clause line: parse all the integers until the end of the line
+        int start = K->nb_lit;
+        while (p < end && *p != '\n') {
+            if (*p == ' ' || *p == '\t' || *p == '\r') {
+                p++;
+                continue;
+            }
+            if ((*p == '<' || *p == '>') && p + 1 < end && p[1] == '=') {
+                // the rest of the line is ignored
+                p = push_card(K, start, p, end);
+                start = K->nb_lit;
+                break;
+            }
+            int neg = 0;
+            if (*p == '-') {
+                neg = 1;
+                p++;
+            }
+            if (p == end || *p < '0' || *p > '9') {
+                K->error = 1;
+                return NULL;
+            }
+            int v = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                v = 10 * v + (*p - '0');
+                p++;
+            }
+            if (v == 0) {
+                if (is_xor) {
+                    // the rest of the line is ignored
+                    push_xor(K, start);
+                    is_xor = 0;
+                    start = K->nb_lit;
+                    break;
+                }
+                push_clause(K, start);
+                start = K->nb_lit;
+                continue;
+            }
+            if (v > K->nb_var) {
+                K->nb_var = v;
+            }
+            push_lit(K, 2 * v + 1 - neg);
+        }
+        // the end of the line also ends the clause
+        if (is_xor) {
+            push_xor(K, start);
+        } else if (K->nb_lit > start) {
+            push_clause(K, start);
+        }
+        p = next_line(p, end);
+    }
+    return NULL;
+}
+
+// look for the "p cnf VARS CLAUSES" header in the first lines of the file
+// returns 1 if the header was found
+static int parse_header(const char* p, const char* end, int* nb_var, int* nb_cl)
+{
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+            p++;
+        }
+        if (p < end && *p == 'p') {
+            // copy the line to have a '\0' at the end
+            char line[256];
+            const char* nl = next_line(p, end);
+            int n = nl - p < 255 ? nl - p : 255;
+            memcpy(line, p, n);
+            line[n] = '\0';
+            return sscanf(line, "p cnf %d %d", nb_var, nb_cl) == 2
+                || sscanf(line, "p cnf+ %d %d", nb_var, nb_cl) == 2;
+        }
+        if (p < end && *p != 'c' && *p != '\n') {
+            return 0; // the header must come before the clauses
+        }
+        p = next_line(p, end);
+    }
+    return 0;
+}
+
+// record the names of variables given by the comments, and return the largest index of a name
+static int parse_names(chunk_t* K, int nb_chunk, const char* end, char*** VarName, int nb_var)
+{
+    int size = nb_var + 1;
+    char** Names = calloc(size, sizeof(char*));
+    char name[NAME_SIZE];
+    char line[2 * NAME_SIZE + 32];
+    for (int k = 0; k < nb_chunk; k++) {
+        for (int i = 0; i < K[k].nb_name; i++) {
+            const char* p = K[k].Name[i];
+            const char* nl = next_line(p, end);
+            int n = nl - p < (int)sizeof(line) - 1 ? nl - p : (int)sizeof(line) - 1;
+            memcpy(line, p, n);
+            line[n] = '\0';
+            if (n > 0 && line[n - 1] == '\n') {
+                line[n - 1] = '\0';
+            }
+            int idx = parse_name_from_comment(line, name);
+            if (idx <= 0) {
+                continue;
+            }
+            if (idx >= size) {
+                int new_size = 2 * idx;
+                Names = realloc(Names, new_size * sizeof(char*));
+                for (int j = size; j < new_size; j++) {
+                    Names[j] = NULL;
+                }
+                size = new_size;
+            }
+            Names[idx] = realloc(Names[idx], NAME_SIZE * sizeof(char));
+            memcpy(Names[idx], name, NAME_SIZE);
+            if (idx > nb_var) {
+                nb_var = idx;
+            }
+        }
+    }
+    *VarName = realloc(Names, (nb_var + 1) * sizeof(char*));
+    return nb_var;
+}
+
+// load a formula from a DIMACS file
+// falls back to parse_formula() when the file cannot be mapped in memory (pipes, ...)
+formula_t* load_formula(char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "*** error opening file %s: %s\n", filename, strerror(errno));
+        exit(5);
+    }
+    struct stat st;
+    const char* data = NULL;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            data = NULL;
+        }
+    }
+    if (data == NULL) {
+        FILE* f_in = fdopen(fd, "r");
+        formula_t* F = parse_formula(f_in);
+        fclose(f_in);
+        return F;
+    }
+    close(fd);
+    size_t size = st.st_size;
+    const char* end = data + size;
+    posix_madvise((void*)data, size, POSIX_MADV_SEQUENTIAL);
+
+    int h_var = 0;
+    int h_cl = 0;
+    if (!parse_header(data, end, &h_var, &h_cl) || h_var < 0 || h_cl < 0) {
+        h_var = 0;
+        h_cl = 0;
+    }
+
+    // cut the file in chunks, at line boundaries
+    long nb_threads = NB_THREADS > 1 ? NB_THREADS : sysconf(_SC_NPROCESSORS_ONLN);
+    int nb_chunk = size / CHUNK_MIN;
+    if (nb_chunk > nb_threads) {
+        nb_chunk = nb_threads;
+    }
+    if (nb_chunk > CHUNK_MAX) {
+        nb_chunk = CHUNK_MAX;
+    }
+    if (nb_chunk < 1) {
+        nb_chunk = 1;
+    }
+    chunk_t K[CHUNK_MAX];
+    const char* p = data;
+    for (int k = 0; k < nb_chunk; k++) {
+        K[k].start = p;
+        p = k == nb_chunk - 1 ? end : next_line(data + (size / nb_chunk) * (k + 1), end);
+        if (p < K[k].start) {
+            p = K[k].start;
+        }
+        K[k].end = p;
+        // preallocate from the header: a literal takes at most nb_digits(h_var) + 2 characters
+        double part = (double)(K[k].end - K[k].start) / size;
+        K[k].size_Cl = h_cl * part + 16;
+        K[k].size_Lit = (K[k].end - K[k].start) / (nb_digits(h_var) + 2) + 16;
+        K[k].Cl = malloc(K[k].size_Cl * sizeof(int));
+        K[k].Lit = malloc(K[k].size_Lit * sizeof(int));
+        K[k].nb_cl = 0;
+        K[k].nb_lit = 0;
+        K[k].CardLit = NULL;
+        K[k].nb_card_lit = 0;
+        K[k].size_CardLit = 0;
+        K[k].Card = NULL;
+        K[k].Bound = NULL;
+        K[k].nb_card = 0;
+        K[k].size_Card = 0;
+        K[k].XorVar = NULL;
+        K[k].nb_xor_var = 0;
+        K[k].size_XorVar = 0;
+        K[k].Xor = NULL;
+        K[k].Parity = NULL;
+        K[k].nb_xor = 0;
+        K[k].size_Xor = 0;
+        K[k].nb_var = 0;
+        K[k].Name = NULL;
+        K[k].nb_name = 0;
+        K[k].size_Name = 0;
+        K[k].eof = 0;
+        K[k].error = 0;
+    }
+
+    if (nb_chunk == 1) {
+        parse_chunk(&K[0]);
+    } else {
+        pthread_t Threads[CHUNK_MAX];
+        for (int k = 0; k < nb_chunk; k++) {
+            pthread_create(&Threads[k], NULL, parse_chunk, &K[k]);
+        }
+        for (int k = 0; k < nb_chunk; k++) {
+            pthread_join(Threads[k], NULL);
+        }
+    }
+
+    // chunks after a '%' line are ignored
+    int used = nb_chunk;
+    for (int k = 0; k < nb_chunk; k++) {
+        if (K[k].error) {
+            fprintf(stderr, "*** error parsing file %s: unexpected character in a clause\n",
+                filename);
+            exit(3);
+        }
+        if (K[k].eof) {
+            used = k + 1;
+            break;
+        }
+    }
+
+    // merge the chunks
+    int nb_var = h_var;
+    int nb_cl = 0;
+    int nb_lit = 0;
+    for (int k = 0; k < used; k++) {
+        nb_var = K[k].nb_var > nb_var ? K[k].nb_var : nb_var;
+        nb_cl += K[k].nb_cl;
+        nb_lit += K[k].nb_lit;
+    }
+    formula_t* F = malloc(sizeof(formula_t));
+    if (used == 1) {
+        // no need to copy anything
+        F->Lit = realloc(K[0].Lit, (nb_lit + 1) * sizeof(int));
+        F->Cl = realloc(K[0].Cl, (nb_cl + 1) * sizeof(int));
+        K[0].Lit = NULL;
+        K[0].Cl = NULL;
+    } else {
+        F->Lit = malloc((nb_lit + 1) * sizeof(int));
+        F->Cl = malloc((nb_cl + 1) * sizeof(int));
+        int cl = 0;
+        int lit = 0;
+        for (int k = 0; k < used; k++) {
+            memcpy(F->Lit + lit, K[k].Lit, K[k].nb_lit * sizeof(int));
+            for (int i = 0; i < K[k].nb_cl; i++) {
+                F->Cl[cl++] = K[k].Cl[i] + lit;
+            }
+            lit += K[k].nb_lit;
+        }
+    }
+    F->Cl[nb_cl] = nb_lit;
+    F->nb_cl = nb_cl;
+    F->nb_lit = nb_lit;
+
+    // merge the cardinality constraints
+    int nb_card = 0;
+    int nb_card_lit = 0;
+    for (int k = 0; k < used; k++) {
+        nb_card += K[k].nb_card;
+        nb_card_lit += K[k].nb_card_lit;
+    }
+    F->CardLit = malloc((nb_card_lit + 1) * sizeof(int));
+    F->Card = malloc((nb_card + 1) * sizeof(int));
+    F->Bound = malloc((nb_card + 1) * sizeof(int));
+    F->nb_card = 0;
+    nb_card_lit = 0;
+    for (int k = 0; k < used; k++) {
+        if (K[k].nb_card == 0) {
+            continue; // CardLit may be NULL
+        }
+        memcpy(F->CardLit + nb_card_lit, K[k].CardLit, K[k].nb_card_lit * sizeof(int));
+        for (int i = 0; i < K[k].nb_card; i++) {
+            F->Bound[F->nb_card] = K[k].Bound[i];
+            F->Card[F->nb_card++] = K[k].Card[i] + nb_card_lit;
+        }
+        nb_card_lit += K[k].nb_card_lit;
+    }
+    F->Card[nb_card] = nb_card_lit;
+
+    // merge the XOR constraints
+    int nb_xor = 0;
+    int nb_xor_var = 0;
+    for (int k = 0; k < used; k++) {
+        nb_xor += K[k].nb_xor;
+        nb_xor_var += K[k].nb_xor_var;
+    }
+    F->XorVar = malloc((nb_xor_var + 1) * sizeof(int));
+    F->Xor = malloc((nb_xor + 1) * sizeof(int));
+    F->Parity = malloc((nb_xor + 1) * sizeof(int));
+    F->nb_xor = 0;
+    nb_xor_var = 0;
+    for (int k = 0; k < used; k++) {
+        if (K[k].nb_xor == 0) {
+            continue; // XorVar may be NULL
+        }
+        memcpy(F->XorVar + nb_xor_var, K[k].XorVar, K[k].nb_xor_var * sizeof(int));
+        for (int i = 0; i < K[k].nb_xor; i++) {
+            F->Parity[F->nb_xor] = K[k].Parity[i];
+            F->Xor[F->nb_xor++] = K[k].Xor[i] + nb_xor_var;
+        }
+        nb_xor_var += K[k].nb_xor_var;
+    }
+    F->Xor[nb_xor] = nb_xor_var;
+    F->nb_var = parse_names(K, used, end, &F->VarName, nb_var);
+    if (h_cl > 0 && h_cl != nb_cl) {
+        LOG(1, "the header announces %d clause(s), but %d were found\n", h_cl, nb_cl);
+    }
+    LOG(1, "%s: %ld byte(s) loaded in %d chunk(s)\n", filename, (long)size, nb_chunk);
+
+    for (int k = 0; k < nb_chunk; k++) {
+        free(K[k].Lit);
+        free(K[k].Cl);
+        free(K[k].CardLit);
+        free(K[k].Card);
+        free(K[k].Bound);
+        free(K[k].XorVar);
+        free(K[k].Xor);
+        free(K[k].Parity);
+        free(K[k].Name);
+    }
+    munmap((void*)data, size);
+    normalize_cards(F);
+    normalize_xors(F);
+    return F;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
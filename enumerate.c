@@ -0,0 +1,123 @@
+#include "sat.h"
+
+// Enumeration of the models.
+//
+// A single solver (see solver.c) is kept for the whole enumeration: after each model, a clause
+// blocking it is added, and the search goes on with all the learned clauses. Without projection,
+// the blocking clause is the negation of the decisions of the model, which only excludes this
+// model and is much shorter than the negation of the whole model. With a projection set, the
+// blocking clause is the negation of the model on the projected variables, so that each
+// projection is only given once.
+
+// parse a list of variables such as "1-10,15,20-22"
+// returns the array of the variables, and stores their number in *n (NULL if the list is invalid)
+int* parse_var_list(char* list, int nb_var, int* n)
+{
+    int* Vars = malloc((nb_var + 1) * sizeof(int));
+    char* In = calloc(nb_var + 1, sizeof(char));
+    *n = 0;
+    char* p = list;
+    while (*p != '\0') {
+        char* end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p) {
+            break;
+        }
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1) {
+                break;
+            }
+            p = end;
+        }
+        if (first < 1 || last > nb_var || first > last) {
+            break;
+        }
+        for (long x = first; x <= last; x++) {
+            if (!In[x]) {
+                In[x] = 1;
+                Vars[(*n)++] = x;
+            }
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            break;
+        }
+    }
+    free(In);
+    if (*p != '\0' || *n == 0) {
+        fprintf(stderr, "*** invalid list of variables: '%s' (there are %d variable(s))\n", list,
+            nb_var);
+        free(Vars);
+        return NULL;
+    }
+    return Vars;
+}
+
+// print a model, restricted to some variables (or to all the variables if Project is NULL)
+static void print_model(formula_t* F, solver_t* L, int* Project, int nb_project)
+{
+    sol_t* S = new_sol(F->nb_var);
+    int n = Project == NULL ? F->nb_var : nb_project;
+    for (int i = 0; i < n; i++) {
+        int x = Project == NULL ? i + 1 : Project[i];
+        S->State[x] = solver_value(L, x);
+        S->Var[S->n++] = x;
+    }
+    print_final_solution(F, S);
+    free_sol(S);
+}
+
+// enumerate the models of a formula (or of its projection on some variables), and print them as
+// they are found (unless quiet)
+// stops after max models if max is not negative, and returns the number of models found
+long enumerate_models(formula_t* F, int* Project, int nb_project, long max, int quiet)
+{
+    solver_t* L = new_solver(F);
+    sol_t* S = new_sol(F->nb_var);
+    int* Block = malloc((F->nb_var + 1) * sizeof(int));
+    long nb_models = 0;
+    while ((max < 0 || nb_models < max) && solver_solve(L, NULL, 0) == 1) {
+        nb_models++;
+        if (!quiet) {
+            print_model(F, L, Project, nb_project);
+            fflush(stdout);
+        }
+        // sanity check
+        S->n = 0;
+        for (int x = 1; x <= F->nb_var; x++) {
+            S->State[x] = solver_value(L, x);
+            S->Var[S->n++] = x;
+        }
+        if (!is_solution(F, S)) {
+            fprintf(stderr, "*** IS THAT REALLY A SOLUTION?\n");
+        }
+
+        int size;
+        if (Project == NULL) {
+            int* Decisions;
+            size = solver_decisions(L, &Decisions);
+            for (int i = 0; i < size; i++) {
+                Block[i] = -Decisions[i];
+            }
+        } else {
+            size = nb_project;
+            for (int i = 0; i < size; i++) {
+                Block[i] = solver_value(L, Project[i]) ? -Project[i] : Project[i];
+            }
+        }
+        LOG(2, "model %ld: blocking clause of size %d\n", nb_models, size);
+        if (solver_add_clause(L, Block, size) == 0) {
+            break; // no other model
+        }
+    }
+    free(Block);
+    free_sol(S);
+    free_solver(L);
+    return nb_models;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
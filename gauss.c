@@ -0,0 +1,448 @@
+#include "sat.h"
+
+// XOR constraints.
+//
+// A XOR constraint l1 XOR ... XOR ln says that an odd number of its literals are true. It is given
+// in a DIMACS file by a line starting with 'x' (for example "x1 -2 3 0"). A negative literal flips
+// the parity of a constraint, which is stored as a set of variables whose XOR is 0 or 1.
+//
+// Only the DPLL search handles them natively, with Gauss-Jordan elimination: the constraints are
+// the rows of a matrix over GF(2), kept in reduced row echelon form, and adding a row to another is
+// a XOR of 64-bit words. When the basic variable of a row is set, another unset variable of the
+// row becomes basic (it is eliminated from the other rows). A row with a single unset variable
+// implies its value, and a row without unset variable whose parity is wrong is a conflict. The
+// row operations keep the solutions of the constraints, so that nothing is undone when
+// backtracking. The other algorithms and the preprocessing get the constraints as clauses (the
+// 2^(n-1) clauses forbidding the assignments of the wrong parity).
+
+// maximal number of literals of the clauses given by the expansion of the constraints
+#define XOR_EXPAND_LIMIT 100000000L
+
+// row r of the matrix, and its bit of column c (which must be a column of its block)
+#define ROW(G, r) ((G)->M + (G)->Offset[r])
+#define ROW_BIT(G, r, c)                                                                           \
+    (((G)->M[(G)->Offset[r] + ((c) >> 6) - (G)->Word[(G)->RowBlock[r]]] >> ((c)&63)) & 1)
+// bit of column c in a mask
+#define GET_BIT(R, c) (((R)[(c) >> 6] >> ((c)&63)) & 1)
+#define SET_BIT(R, c) ((R)[(c) >> 6] |= (uint64_t)1 << ((c)&63))
+#define CLEAR_BIT(R, c) ((R)[(c) >> 6] &= ~((uint64_t)1 << ((c)&63)))
+
+// remove the variables that appear twice in a constraint (x XOR x is 0), and turn the small
+// constraints into clauses: an empty constraint of parity 1 is an empty clause, a constraint with
+// a single variable is a unit clause, and a constraint with two variables gives two binary clauses
+void normalize_xors(formula_t* F)
+{
+    char* Odd = calloc(F->nb_var + 1, sizeof(char));
+    int* Cl = malloc((2 * F->nb_xor + 1) * sizeof(int));
+    int* Lit = malloc((4 * F->nb_xor + 1) * sizeof(int));
+    int nb_cl = 0;
+    int nb_lit = 0;
+    int nb_xor = 0;
+    int nb_xor_var = 0;
+    Cl[0] = 0;
+    for (int c = 0; c < F->nb_xor; c++) {
+        int start = F->Xor[c];
+        int end = F->Xor[c + 1];
+        for (int i = start; i < end; i++) {
+            Odd[F->XorVar[i]] ^= 1;
+        }
+        // the variables that are kept are moved towards the beginning of the arrays
+        int first = nb_xor_var;
+        for (int i = start; i < end; i++) {
+            int x = F->XorVar[i];
+            if (Odd[x]) {
+                Odd[x] = 0;
+                F->XorVar[nb_xor_var++] = x;
+            }
+        }
+        int* v = F->XorVar + first;
+        int size = nb_xor_var - first;
+        int parity = F->Parity[c];
+        if (size > 2) {
+            F->Xor[nb_xor] = first;
+            F->Parity[nb_xor++] = parity;
+            continue;
+        }
+        nb_xor_var = first;
+        if (size == 0 && parity == 1) {
+            Cl[++nb_cl] = nb_lit;
+        } else if (size == 1) {
+            Lit[nb_lit++] = 2 * v[0] + parity;
+            Cl[++nb_cl] = nb_lit;
+        } else if (size == 2) {
+            // x XOR y = 1 gives x v y and -x v -y, x XOR y = 0 gives x v -y and -x v y
+            Lit[nb_lit++] = 2 * v[0] + 1;
+            Lit[nb_lit++] = 2 * v[1] + parity;
+            Cl[++nb_cl] = nb_lit;
+            Lit[nb_lit++] = 2 * v[0];
+            Lit[nb_lit++] = 2 * v[1] + 1 - parity;
+            Cl[++nb_cl] = nb_lit;
+        }
+    }
+    F->nb_xor = nb_xor;
+    F->Xor[nb_xor] = nb_xor_var;
+    append_clauses(F, Cl, Lit, nb_cl, nb_lit);
+    free(Odd);
+    free(Cl);
+    free(Lit);
+}
+
+// replace the XOR constraints by clauses: for each assignment of the variables of a constraint
+// that has the wrong parity, the clause of the negations of its literals
+void expand_xors(formula_t* F)
+{
+    if (F->nb_xor == 0) {
+        return;
+    }
+    // number of literals of the clauses
+    long total = 0;
+    for (int c = 0; c < F->nb_xor; c++) {
+        int n = F->Xor[c + 1] - F->Xor[c];
+        if (n > 30 || (total += (long)n << (n - 1)) > XOR_EXPAND_LIMIT) {
+            fprintf(stderr, "*** too many clauses to expand the XOR constraints (only DPLL handles "
+                            "them)\n");
+            exit(1);
+        }
+    }
+    int* Lit = malloc((total + 1) * sizeof(int));
+    int* Cl = malloc((total + 1) * sizeof(int));
+    int nb_cl = 0;
+    int nb_lit = 0;
+    Cl[0] = 0;
+    for (int c = 0; c < F->nb_xor; c++) {
+        int* v = F->XorVar + F->Xor[c];
+        int n = F->Xor[c + 1] - F->Xor[c];
+        // the bit i of a gives the value of v[i]
+        for (long a = 0; a < 1L << n; a++) {
+            if (__builtin_parityl(a) == F->Parity[c]) {
+                continue;
+            }
+            for (int i = 0; i < n; i++) {
+                Lit[nb_lit++] = 2 * v[i] + 1 - ((a >> i) & 1);
+            }
+            Cl[++nb_cl] = nb_lit;
+        }
+    }
+    LOG(1, "%d XOR constraint(s) expanded into %d clause(s)\n", F->nb_xor, nb_cl);
+    append_clauses(F, Cl, Lit, nb_cl, nb_lit);
+    F->nb_xor = 0;
+    F->Xor[0] = 0;
+    free(Lit);
+    free(Cl);
+}
+
+/////////////////////////////////
+// Gauss-Jordan elimination
+
+// first column of row r that is set in a mask, or EOL
+static int first_bit(gauss_t* G, int r, uint64_t* Mask)
+{
+    int b = G->RowBlock[r];
+    uint64_t* R = ROW(G, r);
+    uint64_t* Mb = Mask + G->Word[b];
+    for (int w = 0; w < G->Word[b + 1] - G->Word[b]; w++) {
+        uint64_t m = R[w] & Mb[w];
+        if (m != 0) {
+            return 64 * (G->Word[b] + w) + __builtin_ctzll(m);
+        }
+    }
+    return EOL;
+}
+
+// make column c (which is set in row r) the basic column of row r: it is eliminated from the
+// other rows of the block, which must be checked again
+static void pivot(gauss_t* G, int r, int c)
+{
+    int b = G->RowBlock[r];
+    int nb_words = G->Word[b + 1] - G->Word[b];
+    uint64_t* R = ROW(G, r);
+    for (int r2 = G->First[b]; r2 < G->First[b + 1]; r2++) {
+        if (r2 != r && ROW_BIT(G, r2, c)) {
+            uint64_t* R2 = ROW(G, r2);
+            for (int w = 0; w < nb_words; w++) {
+                R2[w] ^= R[w];
+            }
+            G->Check[r2] = 1;
+        }
+    }
+    if (G->Pivot[r] != EOL) {
+        G->Basic[G->Pivot[r]] = EOL;
+    }
+    G->Pivot[r] = c;
+    G->Basic[c] = r;
+    G->nb_pivots++;
+}
+
+// representative of the connected component of a variable (with path halving)
+static int find_root(int* Parent, int x)
+{
+    while (Parent[x] != x) {
+        Parent[x] = Parent[Parent[x]];
+        x = Parent[x];
+    }
+    return x;
+}
+
+// create the matrix of the XOR constraints of F (no variable is set yet), in reduced row echelon
+// form, with a block for each connected component of the constraints
+// G->unsat is set if the constraints have no solution
+gauss_t* new_gauss(formula_t* F)
+{
+    gauss_t* G = malloc(sizeof(gauss_t));
+    int nb_rows = F->nb_xor;
+    int* Parent = malloc((F->nb_var + 1) * sizeof(int));
+    for (int x = 0; x <= F->nb_var; x++) {
+        Parent[x] = x;
+    }
+    for (int r = 0; r < nb_rows; r++) {
+        int x = find_root(Parent, F->XorVar[F->Xor[r]]);
+        for (int i = F->Xor[r] + 1; i < F->Xor[r + 1]; i++) {
+            int y = find_root(Parent, F->XorVar[i]);
+            Parent[y] = x;
+            x = find_root(Parent, x);
+        }
+    }
+
+    // the blocks are numbered in the order of their first constraint
+    int* Num = malloc((F->nb_var + 1) * sizeof(int)); // block of each root
+    int* NbVar = calloc(nb_rows + 1, sizeof(int));    // number of variables of each block
+    int* Row = malloc((nb_rows + 1) * sizeof(int));   // row of each constraint
+    G->First = calloc(nb_rows + 2, sizeof(int));
+    G->Col = malloc((F->nb_var + 1) * sizeof(int));
+    for (int x = 0; x <= F->nb_var; x++) {
+        Num[x] = EOL;
+        G->Col[x] = EOL;
+    }
+    G->nb_blocks = 0;
+    for (int r = 0; r < nb_rows; r++) {
+        int root = find_root(Parent, F->XorVar[F->Xor[r]]);
+        if (Num[root] == EOL) {
+            Num[root] = G->nb_blocks++;
+        }
+        int b = Num[root];
+        Row[r] = G->First[b + 1]++;
+        for (int i = F->Xor[r]; i < F->Xor[r + 1]; i++) {
+            if (G->Col[F->XorVar[i]] == EOL) {
+                G->Col[F->XorVar[i]] = NbVar[b]++; // column in the block, for now
+            }
+        }
+    }
+    G->Word = malloc((G->nb_blocks + 1) * sizeof(int));
+    G->Parity = malloc((G->nb_blocks + 1) * sizeof(int));
+    G->Word[0] = 0;
+    for (int b = 0; b < G->nb_blocks; b++) {
+        // the parity is the column after the variables of the block
+        G->First[b + 1] += G->First[b];
+        G->Word[b + 1] = G->Word[b] + NbVar[b] / 64 + 1;
+        G->Parity[b] = 64 * G->Word[b] + NbVar[b];
+    }
+    G->nb_rows = nb_rows;
+    G->nb_cols = 64 * G->Word[G->nb_blocks];
+
+    G->Var = calloc(G->nb_cols + 1, sizeof(int));
+    G->ColBlock = malloc((G->nb_cols + 1) * sizeof(int));
+    for (int b = 0; b < G->nb_blocks; b++) {
+        for (int c = 64 * G->Word[b]; c < 64 * G->Word[b + 1]; c++) {
+            G->ColBlock[c] = b;
+        }
+    }
+    G->RowBlock = malloc((nb_rows + 1) * sizeof(int));
+    G->Offset = malloc((nb_rows + 1) * sizeof(long));
+    long size = 0;
+    for (int b = 0; b < G->nb_blocks; b++) {
+        for (int r = G->First[b]; r < G->First[b + 1]; r++) {
+            G->RowBlock[r] = b;
+            G->Offset[r] = size;
+            size += G->Word[b + 1] - G->Word[b];
+        }
+    }
+    G->M = calloc(size + 1, sizeof(uint64_t));
+    G->Unset = calloc(G->Word[G->nb_blocks] + 1, sizeof(uint64_t));
+    G->True = calloc(G->Word[G->nb_blocks] + 1, sizeof(uint64_t));
+    for (int x = 1; x <= F->nb_var; x++) {
+        if (G->Col[x] != EOL) {
+            G->Col[x] += 64 * G->Word[Num[find_root(Parent, x)]];
+            G->Var[G->Col[x]] = x;
+            SET_BIT(G->Unset, G->Col[x]);
+        }
+    }
+    for (int i = 0; i < nb_rows; i++) {
+        int r = G->First[Num[find_root(Parent, F->XorVar[F->Xor[i]])]] + Row[i];
+        int b = G->RowBlock[r];
+        uint64_t* R = ROW(G, r);
+        for (int j = F->Xor[i]; j < F->Xor[i + 1]; j++) {
+            int c = G->Col[F->XorVar[j]] - 64 * G->Word[b];
+            R[c >> 6] |= (uint64_t)1 << (c & 63);
+        }
+        if (F->Parity[i]) {
+            int c = G->Parity[b] - 64 * G->Word[b];
+            R[c >> 6] |= (uint64_t)1 << (c & 63);
+        }
+    }
+    free(Parent);
+    free(Num);
+    free(NbVar);
+    free(Row);
+
+    G->Pivot = malloc((nb_rows + 1) * sizeof(int));
+    G->Basic = malloc((G->nb_cols + 1) * sizeof(int));
+    for (int r = 0; r < nb_rows; r++) {
+        G->Pivot[r] = EOL;
+    }
+    for (int c = 0; c < G->nb_cols; c++) {
+        G->Basic[c] = EOL;
+    }
+    G->Check = calloc(nb_rows + 1, sizeof(char));
+    G->size_Forced = G->nb_cols + 1;
+    G->Forced = malloc(G->size_Forced * sizeof(int));
+    G->nb_forced = 0;
+    G->next_col = 0;
+    G->unsat = 0;
+    G->nb_pivots = 0;
+
+    // the first column of each row becomes basic (a row that becomes empty stays so, and is never
+    // checked again)
+    int rank = 0;
+    for (int r = 0; r < nb_rows; r++) {
+        int c = first_bit(G, r, G->Unset);
+        if (c != EOL) {
+            pivot(G, r, c);
+            rank++;
+        } else if (ROW_BIT(G, r, G->Parity[G->RowBlock[r]])) {
+            G->unsat = 1; // 0 = 1
+        }
+    }
+    memset(G->Check, 0, nb_rows + 1);
+    LOG(1, "%d XOR constraint(s) in %d block(s), rank %d\n", nb_rows, G->nb_blocks, rank);
+    return G;
+}
+
+// free the matrix of XOR constraints
+void free_gauss(gauss_t* G)
+{
+    if (G == NULL)
+        return;
+    LOG(1, "%ld pivot(s) in the XOR constraints\n", G->nb_pivots);
+    free(G->First);
+    free(G->Word);
+    free(G->Parity);
+    free(G->RowBlock);
+    free(G->ColBlock);
+    free(G->Offset);
+    free(G->M);
+    free(G->Unset);
+    free(G->True);
+    free(G->Col);
+    free(G->Var);
+    free(G->Pivot);
+    free(G->Basic);
+    free(G->Check);
+    free(G->Forced);
+    free(G);
+}
+
+// a literal became true: its column isn't basic anymore (another unset column of its row becomes
+// basic), and the rows of its block that contain it (or that changed) are checked: a row with a
+// single unset column forces its value, and a row without unset column must have the right parity
+// returns 0 in case of conflict
+int assign_gauss(gauss_t* G, int lit)
+{
+    int c = G->Col[VARIABLE(lit)];
+    if (c == EOL) {
+        return 1;
+    }
+    CLEAR_BIT(G->Unset, c);
+    if (SIGN(lit)) {
+        SET_BIT(G->True, c);
+    }
+    int r = G->Basic[c];
+    if (r != EOL) {
+        G->Basic[c] = EOL;
+        G->Pivot[r] = EOL;
+        int d = first_bit(G, r, G->Unset);
+        if (d != EOL) {
+            pivot(G, r, d);
+        }
+    }
+    // the rows that lost their basic column get a new one if they can
+    int b = G->ColBlock[c];
+    for (r = G->First[b]; r < G->First[b + 1]; r++) {
+        if (ROW_BIT(G, r, c)) {
+            G->Check[r] = 1;
+            int d;
+            if (G->Pivot[r] == EOL && (d = first_bit(G, r, G->Unset)) != EOL) {
+                pivot(G, r, d);
+            }
+        }
+    }
+
+    int ok = 1;
+    int nb_words = G->Word[b + 1] - G->Word[b];
+    uint64_t* Unset = G->Unset + G->Word[b];
+    uint64_t* True = G->True + G->Word[b];
+    for (r = G->First[b]; r < G->First[b + 1]; r++) {
+        if (!G->Check[r]) {
+            continue;
+        }
+        G->Check[r] = 0;
+        uint64_t* R = ROW(G, r);
+        int nb_unset = 0;
+        int parity = ROW_BIT(G, r, G->Parity[b]);
+        for (int w = 0; w < nb_words; w++) {
+            nb_unset += __builtin_popcountll(R[w] & Unset[w]);
+            parity ^= __builtin_parityll(R[w] & True[w]);
+        }
+        // parity is now the value that the unset columns must give
+        if (nb_unset == 0 && parity == 1) {
+            ok = 0;
+        } else if (nb_unset == 1) {
+            if (G->nb_forced == G->size_Forced) {
+                G->size_Forced *= 2;
+                G->Forced = realloc(G->Forced, G->size_Forced * sizeof(int));
+            }
+            G->Forced[G->nb_forced++] = 2 * G->Var[first_bit(G, r, G->Unset)] + parity;
+        }
+    }
+    return ok;
+}
+
+// a literal isn't true anymore (its variable may be unset)
+// NOTE: the matrix stays as it is, its rows are still valid constraints
+void unassign_gauss(gauss_t* G, int lit)
+{
+    int c = G->Col[VARIABLE(lit)];
+    if (c == EOL) {
+        return;
+    }
+    SET_BIT(G->Unset, c);
+    CLEAR_BIT(G->True, c);
+    if (c < G->next_col) {
+        G->next_col = c;
+    }
+}
+
+// return a literal implied by the XOR constraints that is still unset, or EOL if there is none
+// NOTE: the Forced stack must be emptied after each backtrack, as for unit clauses
+int next_gauss_literal(sol_t* S, gauss_t* G)
+{
+    while (G->nb_forced > 0) {
+        int lit = G->Forced[--G->nb_forced];
+        if (S->State[VARIABLE(lit)] == UNSET) {
+            return lit;
+        }
+    }
+    return EOL;
+}
+
+// return an unset variable of the XOR constraints, or EOL if they are all set
+int unset_gauss_var(gauss_t* G)
+{
+    for (; G->next_col < G->nb_cols; G->next_col++) {
+        if (GET_BIT(G->Unset, G->next_col)) {
+            return G->Var[G->next_col];
+        }
+    }
+    return EOL;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
@@ -1,17 +1,16 @@
 #include "sat.h"
 
-int VERBOSE = 0;
-int BUF_SIZE = 4096;
-
 void help(char* exec)
 {
     printf("usage: %s [options]\n"
-           "reads a DIMACS file from stdin and tries to satisfies the "
+           "reads a DIMACS file (given as argument, or from stdin) and tries to satisfies the "
            "corresponding DNF formula\n"
+           "(a line \"l1 ... ln <= k\" or \"l1 ... ln >= k\" is a cardinality constraint, and a "
+           "line \"x l1 ... ln 0\" is a XOR constraint)\n"
            "\n"
            "options:\n"
            "  -h  /  --help             this message\n"
-           "  -b  /  --buf_size         set buffer size to read input lines (default: 4096)\n"
+           "  -b  /  --buf_size         set buffer size to read lines from stdin (default: 4096)\n"
            //
            "  -v  /  --verbose          increase verbosity of debug messages\n"
            "  -q  /  --quiet            do not print the solution\n"
@@ -20,7 +19,30 @@ void help(char* exec)
            "  -W  /  --watchlist        use watchlists for the naive algorithm\n"
            "  -A  /  --activelist       use watchlists and an active list of variables\n"
            "  -D  /  --DPLL             use watchlists, an active list, and the DPLL algorithm\n"
-           "  -P  /  --preprocess       preprocess the formula by removing unit clauses\n"
+           "  -C  /  --CDCL             use conflict driven clause learning\n"
+           "  -K  /  --components       solve the connected components separately (with CDCL)\n"
+           "  -Q  /  --cubes            split the formula in cubes (lookahead), solved with CDCL\n"
+           "  -E  /  --exhaustive       try all the assignments, 256 at a time (default when there\n"
+           "                            are at most 20 variables)\n"
+           "  --count                   count the models (with the exhaustive search for small\n"
+           "                            formulas or with -E, and with a model counter otherwise)\n"
+           "  --all                     print all the models, as they are found (with CDCL)\n"
+           "  --max=K                   with --all, stop after K models\n"
+           "  --project=LIST            with --all, print the models restricted to the variables of\n"
+           "                            LIST (for example 1-10,15), each only once\n"
+           "  --threads=N               number of threads for -K, -Q and -E, and with -C, number of\n"
+           "                            CDCL engines sharing clauses (default: 1)\n"
+           "  -V  /  --vsids            choose decision variables by activity (VSIDS)\n"
+           "  -R POLICY  /  --restart=POLICY\n"
+           "                            restart policy for CDCL: none, luby (default) or ema\n"
+           "  --luby_unit=N             number of conflicts between restarts for luby (default: 100)\n"
+           "  --no_phase_saving         do not reuse the last polarity of variables in CDCL\n"
+           "  --pure                    with -D, set the pure literals without trying their negation\n"
+           "  --lookahead               with -D, choose the decisions by propagating both literals of\n"
+           "                            the candidate variables (and find the failed literals)\n"
+           "  -P  /  --preprocess       preprocess the formula by removing unit clauses and\n"
+           "                            eliminating variables\n"
+           "  -B  /  --bce              remove the blocked clauses\n"
            "  -X  /  --negate           print negation of solution, in DIMACS format\n"
            "  -T TEST  /  --test=TEST   call the test function\n",
         exec);
@@ -31,10 +53,25 @@ void help(char* exec)
 #define WATCH 1
 #define ACTIVE 2
 #define DPLL 3
+#define CDCL 4
+#define COMPONENTS 5
+#define BRUTE 6
+#define CUBES 7
 #define TESTS 9
 
-int result(formula_t* F, sol_t* S, int quiet, int invert, int sat)
+// Init is the initial formula when F was simplified (or NULL): the solution is checked against it,
+// after being extended to the removed variables and clauses with the reconstruction stack E
+int result(
+    formula_t* F, formula_t* Init, sol_t* S, extension_t* E, int quiet, int invert, int sat)
 {
+    if (Init != NULL) {
+        free_formula(F);
+        F = Init;
+    }
+    if (sat && E != NULL) {
+        extend_solution(E, S, F->nb_var);
+    }
+    free_extension(E);
     if (sat) {
         if (invert != 1) {
             printf("SATISFIABLE\n");
@@ -64,21 +101,37 @@ int result(formula_t* F, sol_t* S, int quiet, int invert, int sat)
 
 int main(int argc, char* argv[])
 {
-    char short_options[] = "hb:vqT:NWADXP";
+    char short_options[] = "hb:vqT:NWADCKQEVR:XPB";
     static struct option long_options[] = { { "help", no_argument, 0, 'h' },
         { "buf_size", required_argument, 0, 'b' }, { "verbose", no_argument, 0, 'v' },
         { "naive", no_argument, 0, 'N' }, { "watchlist", no_argument, 0, 'W' },
         { "activelist", no_argument, 0, 'A' }, { "DPLL", no_argument, 0, 'D' },
+        { "CDCL", no_argument, 0, 'C' }, { "components", no_argument, 0, 'K' },
+        { "cubes", no_argument, 0, 'Q' },
+        { "exhaustive", no_argument, 0, 'E' }, { "count", no_argument, 0, 'M' },
+        { "all", no_argument, 0, 'a' }, { "max", required_argument, 0, 'm' },
+        { "project", required_argument, 0, 'p' }, { "threads", required_argument, 0, 'J' },
+        { "vsids", no_argument, 0, 'V' },
+        { "restart", required_argument, 0, 'R' }, { "luby_unit", required_argument, 0, 'L' },
+        { "no_phase_saving", no_argument, 0, 'S' }, { "pure", no_argument, 0, 'U' },
+        { "lookahead", no_argument, 0, 'H' },
         { "quiet", no_argument, 0, 'q' }, { "preprocess", no_argument, 0, 'P' },
+        { "bce", no_argument, 0, 'B' },
         { "negate", no_argument, 0, 'X' }, { "test", no_argument, 0, 't' }, { 0, 0, 0, 0 } };
 
     int opt;
     int long_index;
-    int algorithm = DPLL;
+    int algorithm = EOL; // chosen from the size of the formula if not given
     char test_cmd[32] = "";
     int invert = 0;
     int quiet = 0;
     int preproc = 0;
+    int bce = 0;
+    int vsids = 0;
+    int count = 0;
+    int all = 0;
+    long max = -1;
+    char* project = NULL;
 
     while ((opt = getopt_long(argc, argv, short_options, long_options, &long_index)) != -1) {
         switch (opt) {
@@ -94,9 +147,69 @@ int main(int argc, char* argv[])
         case 'D':
             algorithm = DPLL;
             break;
+        case 'C':
+            algorithm = CDCL;
+            break;
+        case 'K':
+            algorithm = COMPONENTS;
+            break;
+        case 'Q':
+            algorithm = CUBES;
+            break;
+        case 'E':
+            algorithm = BRUTE;
+            break;
+        case 'M':
+            count = 1;
+            break;
+        case 'a':
+            all = 1;
+            break;
+        case 'm':
+            max = atol(optarg);
+            break;
+        case 'p':
+            project = optarg;
+            break;
+        case 'J':
+            NB_THREADS = atoi(optarg);
+            if (NB_THREADS < 1) {
+                NB_THREADS = 1;
+            }
+            break;
+        case 'V':
+            vsids = 1;
+            break;
+        case 'R':
+            if (0 == strcmp(optarg, "none")) {
+                RESTART = RESTART_NONE;
+            } else if (0 == strcmp(optarg, "luby")) {
+                RESTART = RESTART_LUBY;
+            } else if (0 == strcmp(optarg, "ema")) {
+                RESTART = RESTART_EMA;
+            } else {
+                fprintf(stderr, "*** unknown restart policy: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'L':
+            LUBY_UNIT = atoi(optarg);
+            break;
+        case 'S':
+            PHASE_SAVING = 0;
+            break;
+        case 'U':
+            PURE_LITERALS = 1;
+            break;
+        case 'H':
+            LOOKAHEAD = 1;
+            break;
         case 'P':
             preproc = 1;
             break;
+        case 'B':
+            bce = 1;
+            break;
         case 'T':
             algorithm = TESTS;
             strncpy(test_cmd, optarg, 32);
@@ -133,32 +246,83 @@ int main(int argc, char* argv[])
         return test(test_cmd, argc, argv);
     }
 
-    FILE* f_in;
+    formula_t* F;
     if (argc > 0) {
-        if (NULL == (f_in = fopen(argv[0], "r"))) {
-            fprintf(stderr, "*** error opening file %s: %s\n", argv[0], strerror(errno));
-            exit(5);
-        }
+        F = load_formula(argv[0]);
     } else {
-        f_in = stdin;
+        F = parse_formula(stdin);
     }
-    formula_t* F = parse_formula(f_in);
     LOG(1, "The formula contains %d variable(s), %d clause(s) for a total of %d literal(s)\n",
         F->nb_var, F->nb_cl, F->nb_lit);
 
+    if (algorithm == EOL) {
+        // small formulas are solved by trying everything
+        if (F->nb_var <= AUTO_BRUTE_VAR) {
+            algorithm = BRUTE;
+        } else {
+            algorithm = DPLL;
+        }
+    }
+    if (algorithm != DPLL || preproc || bce || count || all) {
+        // only the DPLL search handles the cardinality and XOR constraints
+        expand_cards(F);
+        expand_xors(F);
+    }
+    if (algorithm == BRUTE && F->nb_var > MAX_BRUTE_VAR) {
+        fprintf(stderr, "*** Too many variables for the exhaustive search (at most %d)...\n",
+            MAX_BRUTE_VAR);
+        exit(1);
+    }
+
+    if (all) {
+        // the enumeration keeps a single solver, and adds a clause blocking each model
+        if (preproc || bce) {
+            fprintf(stderr, "*** Cannot preprocess the formula when enumerating the models...\n");
+        }
+        int nb_project = 0;
+        int* Project = NULL;
+        if (project != NULL && NULL == (Project = parse_var_list(project, F->nb_var, &nb_project))) {
+            exit(1);
+        }
+        long nb_models = enumerate_models(F, Project, nb_project, max, quiet);
+        printf("c %ld model(s)\n", nb_models);
+        if (nb_models == 0) {
+            printf("UNSATISFIABLE\n");
+        }
+        free(Project);
+        free_formula(F);
+        return nb_models == 0;
+    }
+
     sol_t* S = new_sol(F->nb_var);
+    formula_t* Init = NULL;
+    extension_t* E = NULL;
 
-    if (preproc) {
+    if (preproc || bce) {
         if (algorithm == NAIVE || algorithm == WATCH) {
             fprintf(stderr, "*** Can only preprocess formulas when using active lists...\n");
         } else {
             LOG(1, "preprocessing formula...\n");
+            Init = copy_formula(F);
             int r = preprocess(F, S);
+            if (r == 0 && !count) {
+                // the elimination of variables and clauses doesn't keep the number of models
+                E = new_extension();
+                if (preproc) {
+                    r = simplify_formula(F, S, E);
+                }
+                if (r == 0 && bce) {
+                    r = remove_blocked_clauses(F, S, E);
+                }
+            }
             if (r == -1) {
-                return result(F, S, quiet, invert, 0);
+                if (count) {
+                    printf("c 0 model(s)\n");
+                }
+                return result(F, Init, S, E, quiet, invert, 0);
             }
-            if (r == 1) {
-                return result(F, S, quiet, invert, 1);
+            if (r == 1 && !count) {
+                return result(F, Init, S, E, quiet, invert, 1);
             }
             LOG(1,
                 "The new formula contains %d variable(s), %d clause(s) for a total of %d "
@@ -166,10 +330,32 @@ int main(int argc, char* argv[])
                 F->nb_var, F->nb_cl, F->nb_lit);
         }
     }
+    if (count && algorithm != BRUTE) {
+        // exact model counter (there is no model to print)
+        char* nb_models = count_models(F, S);
+        printf("c %s model(s)\n", nb_models);
+        sat = 0 != strcmp(nb_models, "0");
+        printf(sat ? "SATISFIABLE\n" : "UNSATISFIABLE\n");
+        free(nb_models);
+        free_formula(F);
+        free_formula(Init);
+        free_sol(S);
+        return !sat;
+    }
+
     watchlist_t* W = NULL;
     activelist_t* A = NULL;
+    order_t* O = NULL;
     int BCP = 0;
 
+    if (vsids) {
+        if (algorithm == NAIVE) {
+            fprintf(stderr, "*** Can only use VSIDS with watch lists...\n");
+        } else {
+            O = new_order(F->nb_var);
+        }
+    }
+
     if (algorithm == NAIVE) {
         // nothing to do
     } else if (algorithm == WATCH) {
@@ -178,23 +364,49 @@ int main(int argc, char* argv[])
         W = init_watchlists(F);
         A = init_activelist(F, W);
     } else if (algorithm == DPLL) {
+        // the formula is simplified during the search: the solution is checked against a copy
+        if (Init == NULL) {
+            Init = copy_formula(F);
+        }
+        // the at-most-one constraints encoded by binary clauses become cardinality constraints
+        find_cards(F);
         W = init_watchlists(F);
         A = init_activelist(F, W);
         BCP = 1;
+    } else if (algorithm == CDCL || algorithm == COMPONENTS || algorithm == CUBES
+        || algorithm == BRUTE) {
+        // the CDCL engine uses its own watch lists, and the exhaustive search doesn't need any
     } else {
         fprintf(stderr, "BUG, this shouldn't happen\n");
         exit(7);
     }
 
-    if (W == NULL) {
+    if (algorithm == CDCL && NB_THREADS > 1) {
+        // each engine uses its own variable order
+        sat = solve_portfolio(F, S);
+    } else if (algorithm == CDCL) {
+        sat = solve_cdcl(F, S, O);
+    } else if (algorithm == COMPONENTS) {
+        // each component uses its own variable order
+        sat = solve_components(F, S);
+    } else if (algorithm == CUBES) {
+        sat = solve_cubes(F, S);
+    } else if (algorithm == BRUTE) {
+        unsigned long long nb_models;
+        sat = solve_brute(F, S, count ? &nb_models : NULL);
+        if (count) {
+            printf("c %llu model(s)\n", nb_models);
+        }
+    } else if (W == NULL) {
         sat = solve_naive(F, S);
     } else {
-        sat = solve(F, S, W, A, BCP);
+        sat = solve(F, S, W, A, O, BCP);
     }
     free_watchlist(W);
     free_activelist(A);
+    free_order(O);
 
-    return result(F, S, quiet, invert, sat);
+    return result(F, Init, S, E, quiet, invert, sat);
 }
 
 // vim600: set foldmethod=syntax textwidth=100:
@@ -1,7 +1,46 @@
 #include "sat.h"
 
+// The naive algorithm tries the variables in order, and backtracks as soon as a clause is false.
+// To find false clauses without looking at the whole formula, we keep the number of non-false
+// literals of each clause (NonFalse): when a variable is set, only the clauses that contain the
+// literal that became false (given by the occurrence lists) are updated.
+
+// a literal became false: update the clauses that contain it
+// returns 0 if one of them has no more non-false literal
+static int falsify(occurrences_t* O, int* NonFalse, int lit)
+{
+    int ok = 1;
+    for (int i = O->Start[lit]; i < O->Start[lit + 1]; i++) {
+        if (--NonFalse[O->Occ[i]] == 0) {
+            ok = 0;
+        }
+    }
+    return ok;
+}
+
+// a literal isn't false anymore: update the clauses that contain it
+static void unfalsify(occurrences_t* O, int* NonFalse, int lit)
+{
+    for (int i = O->Start[lit]; i < O->Start[lit + 1]; i++) {
+        NonFalse[O->Occ[i]]++;
+    }
+}
+
+// the literal of a variable that is false in the current solution
+static int false_lit(sol_t* S, int x) { return 2 * x + 1 - (S->State[x] & 1); }
+
 int solve_naive(formula_t* F, sol_t* S)
 {
+    occurrences_t* O = new_occurrences(F);
+    int* NonFalse = malloc((F->nb_cl + 1) * sizeof(int));
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        NonFalse[cl] = F->Cl[cl + 1] - F->Cl[cl];
+        if (NonFalse[cl] == 0) {
+            // empty clause: nothing to try
+            S->n = -1;
+        }
+    }
+
     int cpt = 0;
     while (0 <= S->n && S->n < F->nb_var) {
         assert(check_sol(F, S));
@@ -21,6 +60,7 @@ int solve_naive(formula_t* F, sol_t* S)
             // si la variable avait déjà une valeur, il faut en choisir une autre
             // on change la valeur de TRUE (1) à FALSE_WAS_TRUE (2) et de FALSE (0) à TRUE_WAS_FALSE
             // (3)
+            unfalsify(O, NonFalse, false_lit(S, S->Var[S->n]));
             S->State[S->Var[S->n]] = 3 - S->State[S->Var[S->n]];
         } else {
             fprintf(stderr, "BUG: CECI NE DEVRAIT JAMAIS ARRIVER !\n");
@@ -33,16 +73,20 @@ int solve_naive(formula_t* F, sol_t* S)
             pprint_context(F, S, NULL, NULL);
         }
 
-        if (is_non_false(F, S)) {
+        if (falsify(O, NonFalse, false_lit(S, S->Var[S->n]))) {
             // si les valeurs des variables ne rendent pas la formule fausse, on continue
+            assert(is_non_false(F, S));
             S->n++;
         } else {
             // sinon, il faut revenir en arrière !
-            backtrack_naive(S);
+            assert(!is_non_false(F, S));
+            backtrack_naive(S, O, NonFalse);
             LOG(2, "< < <  backtrack: retour à n = %d\n", S->n);
         }
     }
     LOG(2, "%d solutions essayées\n", cpt);
+    free_occurrences(O);
+    free(NonFalse);
     if (S->n < 0) {
         // non satisfiable
         return 0;
@@ -53,11 +97,13 @@ int solve_naive(formula_t* F, sol_t* S)
     }
 }
 
-int backtrack_naive(sol_t* S)
+// the number of non-false literals of the clauses are restored for the removed variables
+int backtrack_naive(sol_t* S, occurrences_t* O, int* NonFalse)
 {
     // tant que la dernière variable de la solution à été testée sur les 2 valeurs
     while (S->n >= 0
         && (S->State[S->Var[S->n]] == TRUE_WAS_FALSE || S->State[S->Var[S->n]] == FALSE_WAS_TRUE)) {
+        unfalsify(O, NonFalse, false_lit(S, S->Var[S->n]));
         S->State[S->Var[S->n]] = UNSET; // on rénitialise cette variable
         S->Var[S->n] = UNSET;           // on la supprime de la solution courante
         S->n--;
@@ -0,0 +1,227 @@
+#include "sat.h"
+
+// Portfolio.
+//
+// NB_THREADS CDCL engines are run on the same formula (which they only read), each with its own
+// assignment, watch lists and variable order. They differ by the initial order of the variables
+// (seed), the initial polarity and the restart policy, so that they explore different parts of the
+// search space. The first one to find an answer stops the others.
+//
+// The engines share their short learned clauses and the literals they fixed at level 0: each
+// engine writes them to its own ring buffer, and reads the rings of the other engines when it
+// restarts (at level 0, where new clauses can be added without any care). The rings are lock-free:
+// the writer publishes its position after writing a clause, and a reader checks after copying a
+// clause that it wasn't overwritten in the meantime.
+
+// shared data for the threads of the portfolio
+typedef struct {
+    formula_t* F;
+    share_t Share;
+    int stop;       // set by the first thread that finds an answer
+    int winner;     // number of this thread
+    int sat;        // its answer
+    sol_t** Sol;    // assignment of each thread
+    pthread_mutex_t lock;
+} portfolio_t;
+
+// data of a thread
+typedef struct {
+    portfolio_t* P;
+    int id;
+} worker_t;
+
+//////////////////
+// sharing clauses
+
+// write a clause in the ring of a thread
+void export_clause(cdcl_t* C, int* lits, int size)
+{
+    ring_t* R = &C->Share->Ring[C->share_id];
+    unsigned long head = R->head; // only this thread modifies it
+    // a reader that sees one of the words below will also see the previous head (so that it knows
+    // its copy may be overwritten)
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&R->Buf[head % SHARE_RING], size, __ATOMIC_RELAXED);
+    for (int i = 0; i < size; i++) {
+        __atomic_store_n(&R->Buf[(head + 1 + i) % SHARE_RING], lits[i], __ATOMIC_RELAXED);
+    }
+    // the clause is visible once the new head is
+    __atomic_store_n(&R->head, head + 1 + size, __ATOMIC_RELEASE);
+    C->nb_exported++;
+}
+
+// read the clauses written by the other threads since the last call, and export the literals
+// fixed at level 0 since the last call
+// returns 0 if the formula was found unsatisfiable
+int exchange_clauses(cdcl_t* C)
+{
+    assert(C->level == 0);
+    sol_t* S = C->S;
+    for (; C->exported < S->n; C->exported++) {
+        int x = S->Var[C->exported];
+        int lit = 2 * x + (S->State[x] & 1);
+        export_clause(C, &lit, 1);
+    }
+
+    int lits[SHARE_SIZE];
+    for (int t = 0; t < C->Share->nb_threads; t++) {
+        if (t == C->share_id) {
+            continue;
+        }
+        ring_t* R = &C->Share->Ring[t];
+        unsigned long head = __atomic_load_n(&R->head, __ATOMIC_ACQUIRE);
+        unsigned long pos = C->Read[t];
+        if (head + 1 + SHARE_SIZE - pos > SHARE_RING) {
+            // we were too slow, the clauses we didn't read may be overwritten
+            pos = head;
+        }
+        while (pos < head) {
+            int size = __atomic_load_n(&R->Buf[pos % SHARE_RING], __ATOMIC_RELAXED);
+            for (int i = 0; i < size && i < SHARE_SIZE; i++) {
+                lits[i] = __atomic_load_n(&R->Buf[(pos + 1 + i) % SHARE_RING], __ATOMIC_RELAXED);
+            }
+            // the writer may have overwritten the clause while we were copying it (it may be
+            // writing up to 1 + SHARE_SIZE words after its head)
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            unsigned long now = __atomic_load_n(&R->head, __ATOMIC_RELAXED);
+            if (now + 1 + SHARE_SIZE - pos > SHARE_RING) {
+                pos = now;
+                break;
+            }
+            assert(1 <= size && size <= SHARE_SIZE);
+            pos += 1 + size;
+            if (!import_clause(C, lits, size)) {
+                return 0;
+            }
+        }
+        C->Read[t] = pos;
+    }
+    // the imported units are already known by the other threads
+    C->exported = S->n;
+    return 1;
+}
+
+///////////////////////
+// running the threads
+
+// pseudo-random numbers (xorshift)
+static unsigned next_random(unsigned* seed)
+{
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+// thread function: run a CDCL engine with settings depending on the number of the thread
+static void* worker(void* arg)
+{
+    worker_t* T = arg;
+    portfolio_t* P = T->P;
+    formula_t* F = P->F;
+    int id = T->id;
+    sol_t* S = P->Sol[id];
+
+    order_t* O = new_order(F->nb_var);
+    cdcl_t* C = new_cdcl(F, S, O);
+    C->Stop = &P->stop;
+    C->Share = &P->Share;
+    C->share_id = id;
+    C->Read = calloc(P->Share.nb_threads, sizeof(unsigned long));
+
+    // diversification: thread 0 uses the default settings
+    unsigned seed = 2654435761u * (id + 1);
+    if (id > 0) {
+        // random initial order of the variables
+        for (int x = 1; x <= F->nb_var; x++) {
+            O->inc = (next_random(&seed) % 1000) * 1e-6;
+            bump_order(O, x);
+        }
+        O->inc = 1.0;
+        // polarity: all true, random, or all false
+        for (int x = 1; x <= F->nb_var; x++) {
+            C->Phase[x] = id % 3 == 1 ? 1 : id % 3 == 2 ? next_random(&seed) & 1 : 0;
+        }
+        // restart policy
+        if (id % 2 == 1) {
+            C->restart = RESTART_EMA;
+        } else {
+            C->luby_unit = 50 << (id / 2 % 3);
+        }
+    }
+
+    int r = run_cdcl(C);
+    LOG(2, "thread %d: %ld conflict(s), %ld clause(s) exported, %ld imported\n", id,
+        C->nb_conflicts, C->nb_exported, C->nb_imported);
+    if (r != -1) {
+        pthread_mutex_lock(&P->lock);
+        if (P->winner == EOL) {
+            P->winner = id;
+            P->sat = r;
+            __atomic_store_n(&P->stop, 1, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&P->lock);
+    }
+    free(C->Read);
+    free_cdcl(C);
+    free_order(O);
+    return NULL;
+}
+
+// look for a solution with NB_THREADS CDCL engines sharing clauses
+int solve_portfolio(formula_t* F, sol_t* S)
+{
+    portfolio_t P;
+    int n = NB_THREADS;
+    P.F = F;
+    P.Share.nb_threads = n;
+    P.Share.Ring = malloc(n * sizeof(ring_t));
+    P.stop = 0;
+    P.winner = EOL;
+    P.sat = 0;
+    P.Sol = malloc(n * sizeof(sol_t*));
+    pthread_mutex_init(&P.lock, NULL);
+    worker_t* T = malloc(n * sizeof(worker_t));
+    pthread_t* Threads = malloc(n * sizeof(pthread_t));
+    for (int t = 0; t < n; t++) {
+        P.Share.Ring[t].Buf = malloc(SHARE_RING * sizeof(int));
+        P.Share.Ring[t].head = 0;
+        P.Sol[t] = new_sol(F->nb_var);
+        T[t].P = &P;
+        T[t].id = t;
+    }
+    for (int t = 0; t < n; t++) {
+        pthread_create(&Threads[t], NULL, worker, &T[t]);
+    }
+    for (int t = 0; t < n; t++) {
+        pthread_join(Threads[t], NULL);
+    }
+    LOG(1, "thread %d found the answer first\n", P.winner);
+
+    int sat = P.sat;
+    if (sat) {
+        // S may already contain some values (for variables that don't appear in F)
+        sol_t* W = P.Sol[P.winner];
+        for (int x = 1; x <= F->nb_var; x++) {
+            if (S->State[x] == UNSET) {
+                S->State[x] = W->State[x];
+                S->Var[S->n++] = x;
+            }
+        }
+    } else {
+        S->n = -1;
+    }
+
+    for (int t = 0; t < n; t++) {
+        free(P.Share.Ring[t].Buf);
+        free_sol(P.Sol[t]);
+    }
+    pthread_mutex_destroy(&P.lock);
+    free(P.Share.Ring);
+    free(P.Sol);
+    free(T);
+    free(Threads);
+    return sat;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
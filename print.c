@@ -72,28 +72,20 @@ void pprint_CNF(formula_t* F)
     fprintf(stderr, "\n");
 }
 
-// print all the active lists
+// print all the watch lists
 void pprint_watchlists(formula_t* F, watchlist_t* W)
 {
     for (int x = 1; x <= F->nb_var; x++) {
-        if (W->Head[x][0] == EOL && W->Head[x][1] == EOL) {
-            continue;
-        }
-        if (W->Head[x][0] != EOL) {
-            fprintf(stderr, "       ¬");
-            pprint_var(x);
-            fprintf(stderr, ": ");
-            for (int cl = W->Head[x][0]; cl != EOL; cl = W->Next[cl]) {
-                fprintf(stderr, "(%d) ", cl);
+        for (int s = 0; s < 2; s++) {
+            int lit = 2 * x + s;
+            if (W->Size[lit] == 0) {
+                continue;
             }
-            fprintf(stderr, "\n");
-        }
-        if (W->Head[x][1] != EOL) {
-            fprintf(stderr, "        ");
+            fprintf(stderr, s ? "        " : "       ¬");
             pprint_var(x);
             fprintf(stderr, ": ");
-            for (int cl = W->Head[x][1]; cl != EOL; cl = W->Next[cl]) {
-                fprintf(stderr, "(%d) ", cl);
+            for (int i = 0; i < W->Size[lit]; i++) {
+                fprintf(stderr, "(%d) ", W->Watch[lit][i].cl);
             }
             fprintf(stderr, "\n");
         }
@@ -0,0 +1,309 @@
+#include "sat.h"
+
+// Probing of the binary implication graph (with -P).
+//
+// Each binary clause a v b gives two implications -a -> b and -b -> a. The literals of a strongly
+// connected component of this graph are all equivalent: each of them is replaced by a single
+// representative, which removes variables and binary clauses. A component containing both a
+// literal and its negation makes the formula unsatisfiable.
+//
+// The roots of the graph are then probed: when assigning a literal l at a new level leads to a
+// conflict, -l is a unit clause (l is a failed literal). Otherwise, each literal a implied by a
+// longer clause gives the hyper-binary resolvent -l v a, which adds edges to the graph and may
+// reveal new equivalences.
+
+// maximal number of rounds (equivalences then probing)
+#define PROBE_ROUNDS 2
+// budget of propagations for the probing of each round
+#define PROBE_PROPAGATIONS 10000000
+// maximal number of hyper-binary resolvents added in each round
+#define PROBE_HBR_LIMIT 100000
+
+///////////////////////////
+// equivalent literals
+
+// strongly connected components of the binary implication graph (Tarjan's algorithm, without
+// recursion)
+// Repr (array of size 2*nb_var+2) receives the representative of each literal: the smallest
+// literal of its component
+// returns 0 if a literal is equivalent to its negation, 1 otherwise
+static int find_equivalences(formula_t* F, int* Repr)
+{
+    int N = 2 * F->nb_var + 2;
+    // the implication graph: successors of lit in Adj[Start[lit]] ... Adj[Start[lit+1]-1]
+    int* Start = calloc(N + 1, sizeof(int));
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        if (F->Cl[cl + 1] - F->Cl[cl] == 2) {
+            Start[(F->Lit[F->Cl[cl]] ^ 1) + 1]++;
+            Start[(F->Lit[F->Cl[cl] + 1] ^ 1) + 1]++;
+        }
+    }
+    for (int lit = 0; lit < N; lit++) {
+        Start[lit + 1] += Start[lit];
+    }
+    int* Adj = malloc((Start[N] + 1) * sizeof(int));
+    int* Next = malloc(N * sizeof(int));
+    memcpy(Next, Start, N * sizeof(int));
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        if (F->Cl[cl + 1] - F->Cl[cl] == 2) {
+            int a = F->Lit[F->Cl[cl]];
+            int b = F->Lit[F->Cl[cl] + 1];
+            Adj[Next[a ^ 1]++] = b;
+            Adj[Next[b ^ 1]++] = a;
+        }
+    }
+
+    int* Index = malloc(N * sizeof(int));
+    int* Low = malloc(N * sizeof(int));
+    char* OnStack = calloc(N, sizeof(char));
+    int* Stack = malloc(N * sizeof(int)); // literals of the components being built
+    int* Call = malloc(N * sizeof(int));  // depth first search
+    int sp = 0;
+    int index = 0;
+    for (int lit = 0; lit < N; lit++) {
+        Index[lit] = EOL;
+        Repr[lit] = lit;
+    }
+    for (int root = 2; root < N; root++) {
+        if (Index[root] != EOL || Start[root] == Start[root + 1]) {
+            continue;
+        }
+        int cp = 0;
+        Index[root] = Low[root] = index++;
+        Stack[sp++] = root;
+        OnStack[root] = 1;
+        Call[cp++] = root;
+        Next[root] = Start[root];
+        while (cp > 0) {
+            int u = Call[cp - 1];
+            if (Next[u] < Start[u + 1]) {
+                int w = Adj[Next[u]++];
+                if (Index[w] == EOL) {
+                    Index[w] = Low[w] = index++;
+                    Stack[sp++] = w;
+                    OnStack[w] = 1;
+                    Call[cp++] = w;
+                    Next[w] = Start[w];
+                } else if (OnStack[w] && Index[w] < Low[u]) {
+                    Low[u] = Index[w];
+                }
+                continue;
+            }
+            cp--;
+            if (cp > 0 && Low[u] < Low[Call[cp - 1]]) {
+                Low[Call[cp - 1]] = Low[u];
+            }
+            if (Low[u] == Index[u]) {
+                // u is the first literal of a component
+                int first = sp;
+                int min = u;
+                do {
+                    first--;
+                    OnStack[Stack[first]] = 0;
+                    if (Stack[first] < min) {
+                        min = Stack[first];
+                    }
+                } while (Stack[first] != u);
+                for (int i = first; i < sp; i++) {
+                    Repr[Stack[i]] = min;
+                }
+                sp = first;
+            }
+        }
+    }
+    int ok = 1;
+    for (int x = 1; x <= F->nb_var; x++) {
+        if (Repr[2 * x] == Repr[2 * x + 1]) {
+            ok = 0;
+        }
+    }
+    free(Start);
+    free(Adj);
+    free(Next);
+    free(Index);
+    free(Low);
+    free(OnStack);
+    free(Stack);
+    free(Call);
+    return ok;
+}
+
+// replace each literal by its representative (the repeated literals and the tautologies are
+// removed as well)
+// the components of a literal and of its negation are symmetric, so that the representative of
+// the negation is the negation of the representative
+// the equivalences are pushed on E, to give a value to the replaced variables
+// returns the number of replaced variables
+static int substitute_equivalences(formula_t* F, int* Repr, extension_t* E)
+{
+    int nb_replaced = 0;
+    for (int x = 1; x <= F->nb_var; x++) {
+        int r = Repr[2 * x + 1];
+        if (r != 2 * x + 1) {
+            int c1[2] = { 2 * x + 1, r ^ 1 };
+            int c2[2] = { 2 * x, r };
+            push_extension(E, c1, 2, 2 * x + 1);
+            push_extension(E, c2, 2, 2 * x);
+            nb_replaced++;
+        }
+    }
+
+    // the clauses only get shorter: the formula is rewritten in place
+    char* Mark = calloc(2 * F->nb_var + 2, sizeof(char));
+    int nb_cl = 0;
+    int nb_lit = 0;
+    int start = F->Cl[0];
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        int end = F->Cl[cl + 1];
+        int tautology = 0;
+        F->Cl[nb_cl] = nb_lit;
+        for (int i = start; i < end; i++) {
+            int lit = Repr[F->Lit[i]];
+            tautology |= Mark[lit ^ 1];
+            if (!Mark[lit]) {
+                Mark[lit] = 1;
+                F->Lit[nb_lit++] = lit;
+            }
+        }
+        for (int i = F->Cl[nb_cl]; i < nb_lit; i++) {
+            Mark[F->Lit[i]] = 0;
+        }
+        if (tautology) {
+            nb_lit = F->Cl[nb_cl];
+        } else {
+            nb_cl++;
+        }
+        start = end;
+    }
+    F->nb_cl = nb_cl;
+    F->nb_lit = nb_lit;
+    F->Cl[nb_cl] = nb_lit;
+    free(Mark);
+    return nb_replaced;
+}
+
+///////////////////////////
+// failed literals
+
+// probe the roots of the binary implication graph with the CDCL engine
+// the unit clauses and the hyper-binary resolvents found are added to the formula
+// returns -1 if the formula is unsatisfiable, and the number of failed literals otherwise
+static int probe_literals(formula_t* F, int* nb_hbr)
+{
+    int N = 2 * F->nb_var + 2;
+    // a literal is a root if it has successors but no predecessor
+    char* In = calloc(N, sizeof(char));
+    char* Out = calloc(N, sizeof(char));
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        if (F->Cl[cl + 1] - F->Cl[cl] == 2) {
+            for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+                In[F->Lit[i]] = 1;
+                Out[F->Lit[i] ^ 1] = 1;
+            }
+        }
+    }
+    *nb_hbr = 0;
+    int nb_roots = 0;
+    for (int lit = 2; lit < N; lit++) {
+        nb_roots += !In[lit] && Out[lit];
+    }
+    if (nb_roots == 0) {
+        free(In);
+        free(Out);
+        return 0;
+    }
+
+    sol_t* S = new_sol(F->nb_var);
+    cdcl_t* C = new_cdcl(F, S, NULL);
+    int* Hbr = malloc(2 * PROBE_HBR_LIMIT * sizeof(int));
+    int nb_failed = 0;
+    long budget = C->nb_propagations + PROBE_PROPAGATIONS;
+    // the unit clauses of the formula are propagated first
+    if (!C->unsat) {
+        propagate_pending(C);
+    }
+    for (int lit = 2; lit < N && !C->unsat && C->nb_propagations < budget; lit++) {
+        if (In[lit] || !Out[lit] || C->Val[lit] != UNSET) {
+            continue;
+        }
+        if (!push_decision(C, lit)) {
+            if (C->unsat) {
+                break;
+            }
+            // failed literal
+            int unit = lit ^ 1;
+            nb_failed++;
+            if (add_formula_clause(C, &unit, 1)) {
+                propagate_pending(C);
+            }
+            continue;
+        }
+        // the literals implied through a longer clause give hyper-binary resolvents
+        for (int i = C->TrailLim[0] + 1; i < S->n && *nb_hbr < PROBE_HBR_LIMIT; i++) {
+            int x = S->Var[i];
+            int cr = C->Reason[x];
+            if (cr != EOL && CLAUSE(C->A, cr)->size > 2) {
+                Hbr[2 * *nb_hbr] = lit ^ 1;
+                Hbr[2 * *nb_hbr + 1] = 2 * x + (S->State[x] & 1);
+                (*nb_hbr)++;
+            }
+        }
+        pop_decision(C);
+    }
+    int unsat = C->unsat;
+    if (!unsat) {
+        // the level 0 assignments are added as unit clauses, after the binary clauses
+        int nb_units = C->level == 0 ? S->n : C->TrailLim[0];
+        F->Lit = realloc(F->Lit, (F->nb_lit + nb_units + 2 * *nb_hbr + 1) * sizeof(int));
+        F->Cl = realloc(F->Cl, (F->nb_cl + nb_units + *nb_hbr + 1) * sizeof(int));
+        for (int i = 0; i < *nb_hbr; i++) {
+            F->Lit[F->nb_lit++] = Hbr[2 * i];
+            F->Lit[F->nb_lit++] = Hbr[2 * i + 1];
+            F->Cl[++F->nb_cl] = F->nb_lit;
+        }
+        for (int i = 0; i < nb_units; i++) {
+            int x = S->Var[i];
+            F->Lit[F->nb_lit++] = 2 * x + (S->State[x] & 1);
+            F->Cl[++F->nb_cl] = F->nb_lit;
+        }
+    }
+    free_cdcl(C);
+    free_sol(S);
+    free(Hbr);
+    free(In);
+    free(Out);
+    return unsat ? -1 : nb_failed;
+}
+
+// replace the equivalent literals and probe the failed literals, and then propagate the unit
+// clauses found and simplify the formula (with preprocess())
+// returns -1 if the formula is unsatisfiable, 1 if it is satisfied by S, and 0 otherwise
+int probe_formula(formula_t* F, sol_t* S, extension_t* E)
+{
+    int* Repr = malloc((2 * F->nb_var + 2) * sizeof(int));
+    int r = 0;
+    for (int round = 0; round < PROBE_ROUNDS && r == 0; round++) {
+        if (!find_equivalences(F, Repr)) {
+            r = -1;
+            break;
+        }
+        int nb_replaced = substitute_equivalences(F, Repr, E);
+        int nb_hbr;
+        int nb_failed = probe_literals(F, &nb_hbr);
+        if (nb_failed == -1) {
+            r = -1;
+            break;
+        }
+        LOG(1, "%d equivalent variable(s) replaced, %d failed literal(s), %d hyper-binary "
+               "resolvent(s)\n",
+            nb_replaced, nb_failed, nb_hbr);
+        r = preprocess(F, S);
+        if (nb_replaced == 0 && nb_failed == 0 && nb_hbr == 0) {
+            break;
+        }
+    }
+    free(Repr);
+    return r;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
@@ -7,7 +7,9 @@
 #include <assert.h>
 #include <errno.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -38,11 +40,28 @@
 #define TRUE 1           // variable is currently set to "true", and "false" hasn't yet been tested
 #define FALSE_WAS_TRUE 2 // variable is currently set to "false", "true" has already been tested
 #define TRUE_WAS_FALSE 3 // variable is currently set to "true", "false" has already been tested
-#define FORCED_FALSE 4   // variable is currently set to "false" and was forced (unit clause)
-#define FORCED_TRUE 5    // variable is currently set to "true" and was forced (unit clause)
+#define FORCED_FALSE 4   // variable is currently set to "false" and was forced (unit clause or
+                         // pure literal)
+#define FORCED_TRUE 5    // variable is currently set to "true" and was forced (unit clause or pure
+                         // literal)
 
 #define EOL -1 // end of list, used for watch lists
 
+// restart policies for the CDCL engine
+#define RESTART_NONE 0 // never restart
+#define RESTART_LUBY 1 // restart after LUBY_UNIT * luby(i) conflicts
+#define RESTART_EMA 2  // restart when recent conflicts are much deeper than on average
+
+// largest number of variables for the exhaustive search (the number of assignments must fit in
+// 64 bits), and number of variables below which it is chosen by default
+#define MAX_BRUTE_VAR 62
+#define AUTO_BRUTE_VAR 20
+
+// clause sharing between the threads of the portfolio: size of the ring buffers (in words, a power
+// of 2), and largest learned clauses that are shared
+#define SHARE_RING (1 << 16)
+#define SHARE_SIZE 8
+
 //////////////////////////////////////////////////
 //////////////////////////////////////////////////
 // types for representing formula and other things
@@ -55,6 +74,14 @@ typedef struct {
     int nb_lit;     // total number of literals in the CNF formula
     int* Lit;       // array of literals (of size nb_lit)
     int* Cl;        // array of size nb_cl+1 giving the start of each clause in the Lit array
+    int nb_card;    // number of cardinality constraints (at most Bound[i] of their literals true)
+    int* CardLit;   // array of the literals of the cardinality constraints
+    int* Card;      // array of size nb_card+1 giving the start of each constraint in CardLit
+    int* Bound;     // array of size nb_card giving the bound of each constraint
+    int nb_xor;     // number of XOR constraints (the XOR of their variables is Parity[i])
+    int* XorVar;    // array of the variables of the XOR constraints
+    int* Xor;       // array of size nb_xor+1 giving the start of each constraint in XorVar
+    int* Parity;    // array of size nb_xor giving the parity of each constraint
     char** VarName; // array giving the name (if relevant) of each variable
 } formula_t;
 
@@ -67,24 +94,264 @@ typedef struct {
                  // should have value UNSET (-1)...
 } sol_t;
 
-// type for watch lists
+// type for the reconstruction stack: clauses removed by the preprocessing that may become false
+// when the solution of the preprocessed formula is extended to the removed variables. Each clause
+// is stored with its pivot first: going through the stack backwards, the pivot of each clause
+// that is false is made true.
+typedef struct {
+    int nb_cl;   // number of clauses on the stack
+    int nb_lit;  // total number of literals
+    int* Lit;    // literals of the clauses (the pivot of each clause first)
+    int* Cl;     // array of size nb_cl+1 giving the start of each clause in Lit
+    int cap_cl;  // allocated sizes
+    int cap_lit;
+} extension_t;
+
+// type for the clauses of a formula during the preprocessing: clauses can be removed and added,
+// and the clauses containing each literal are known
+typedef struct {
+    int nb_var;
+    int nb_cl;       // number of clauses (including the deleted ones)
+    int cap_cl;      // allocated number of clauses
+    int* Lit;        // literals of all the clauses, one after the other
+    int nb_lit;      // number of literals in Lit (including those of the deleted clauses)
+    int cap_lit;     // allocated size of Lit
+    int* Start;      // start of each clause in Lit
+    int* Size;       // size of each clause
+    unsigned long long* Signature;  // bit VARIABLE(lit)%64 is set for each literal of the clause
+    char* Deleted;   // is the clause deleted?
+    int nb_deleted;  // number of deleted clauses
+    int** Occ;       // array of size 2*nb_var+2: clauses containing each literal (deleted clauses
+                     // are removed lazily)
+    int* nb_occ;     // size of each occurrence list
+    int* cap_occ;    // allocated size of each occurrence list
+    char* Touched;   // array of size nb_var+1: has a clause of the variable been added or deleted?
+} simp_t;
+
+// type for watchers: a clause watched by a literal, with another literal of the clause (the
+// blocking literal). When the blocking literal is true, the clause is satisfied and can be skipped
+// without looking at its literals.
 typedef struct {
-    int* Next;      // array of size nb_cl: for each clause, gives another clause with same
-                    // watching literal
-    int (*Head)[2]; // 0 -> array of size nb_var: head of watch list for negative literals
-                    // 1 -> array of size nb_var: head of watch list for positive literals
+    int cl;      // index of the clause
+    int blocker; // blocking literal
+} watcher_t;
+
+// type for watch lists: each clause is watched by its first two literals (or by its only literal)
+typedef struct {
+    int nb_lit;         // number of literals (2*nb_var+2)
+    watcher_t** Watch;  // array of size nb_lit: contiguous array of watchers for each literal
+    int* Size;          // array of size nb_lit: number of watchers for each literal
+    int* Cap;           // array of size nb_lit: allocated size of each array of watchers
+    int* Unit;          // array of size nb_cl: stack of clauses that were found to be unit
+    int nb_unit;        // number of clauses in the Unit stack
+    int conflict;       // last clause found false by update_watch_lists()
 } watchlist_t;
 
+// type for occurrence lists: the clauses that contain each literal
+typedef struct {
+    int nb_lit; // number of literals (2*nb_var+2)
+    int* Start; // array of size nb_lit+1: the clauses containing lit are Occ[Start[lit]] up to
+                // Occ[Start[lit+1]-1]
+    int* Occ;   // array of size nb_lit of the formula: indices of clauses
+} occurrences_t;
+
+// type for pure literals (DPLL): the number of occurrences of each literal in the clauses that are
+// not satisfied, updated when variables are set and unset
+typedef struct {
+    occurrences_t* O; // occurrence lists of the formula
+    int* NbTrue;      // array of size nb_cl: number of true literals of each clause
+    int* Count;       // array of size nb_lit: occurrences of each literal in unsatisfied clauses
+    int* Pure;        // array of size nb_lit: stack of literals that may be pure
+    int nb_pure;      // number of literals in the Pure stack
+    char* InPure;     // array of size nb_lit: is the literal in the Pure stack?
+} pure_t;
+
+// type for the cardinality constraints during the DPLL search: the number of true literals of each
+// constraint, and the literals that must be false because a constraint reached its bound
+typedef struct {
+    int* Start;    // array of size nb_lit+1: the constraints containing lit are Occ[Start[lit]]
+                   // up to Occ[Start[lit+1]-1]
+    int* Occ;      // indices of constraints
+    int* NbTrue;   // array of size nb_card: number of true literals of each constraint
+    int* Forced;   // stack of literals that are forced to be true (negations of literals of full
+                   // constraints)
+    int nb_forced; // number of literals in the Forced stack
+    int nb_var;    // number of variables
+    int next_var;  // the variables of the constraints before next_var are all set
+} cardlist_t;
+
+// type for the XOR constraints during the DPLL search: a matrix over GF(2), with a row for each
+// constraint and a column for each variable, kept in reduced row echelon form. The matrix is cut in
+// independent blocks (the connected components of the constraints): the columns of a block are the
+// bits of a range of 64-bit words (the last column being the parity), and its rows only have these
+// words. Each row with an unset variable has a basic column (whose bit is only set in that row),
+// which is unset.
+typedef struct {
+    int nb_rows;
+    int nb_cols;      // number of columns (the columns of a block start at a multiple of 64)
+    int nb_blocks;    // number of blocks
+    int* First;       // array of size nb_blocks+1: first row of each block
+    int* Word;        // array of size nb_blocks+1: first word of the columns of each block
+    int* Parity;      // parity column of each block
+    int* RowBlock;    // block of each row
+    int* ColBlock;    // block of each column
+    long* Offset;     // start of each row in M
+    uint64_t* M;      // the rows
+    uint64_t* Unset;  // bits of the unset columns
+    uint64_t* True;   // bits of the true columns
+    int* Col;         // array of size nb_var+1: column of each variable (EOL if there is none)
+    int* Var;         // variable of each column (0 for the parity columns and the unused bits)
+    int* Pivot;       // basic column of each row (EOL if there is none)
+    int* Basic;       // row of each column (EOL for the columns that are not basic)
+    char* Check;      // rows to check after an assignment
+    int* Forced;      // stack of literals implied by the rows
+    int nb_forced;    // number of literals in the Forced stack
+    int size_Forced;  // actual size of the Forced stack
+    int next_col;     // the columns before next_col are all set
+    int unsat;        // set when the constraints have no solution
+    long nb_pivots;   // statistics: number of changes of basic column
+} gauss_t;
+
+// type for clauses stored in a clause arena: a header followed by the literals
+typedef struct {
+    unsigned size : 28;    // number of literals
+    unsigned learnt : 1;   // is it a learned clause?
+    unsigned vivified : 1; // was the clause already vivified?
+    unsigned deleted : 1;  // deleted clause (its memory is reclaimed by the garbage collector)
+    unsigned moved : 1;    // clause moved by the garbage collector: lits[0] is its new reference
+    int lbd;               // number of distinct decision levels in the clause when it was learned
+    float activity;        // activity of a learned clause (bumped when it takes part in a conflict)
+    int lits[];            // the literals
+} clause_t;
+
+// type for clause arenas: the clauses are stored one after the other in a single array of words,
+// and each clause is designated by its offset in this array (its reference)
+typedef struct {
+    int* Mem;   // array of words
+    int size;   // number of words in use
+    int cap;    // allocated number of words
+    int wasted; // number of words used by deleted clauses
+} arena_t;
+
+// get a clause from its reference
+#define CLAUSE(A, cr) ((clause_t*)((A)->Mem + (cr)))
+// number of words used by a clause with a given number of literals
+#define CLAUSE_WORDS(size) ((int)(sizeof(clause_t) / sizeof(int)) + (size))
+
 // type for active list
 typedef struct {
     int last_active; // last element of the active list (or EOL)
-    int* NextA;      // array of size nb_var: next variable in the active list (or EOL)
+    int* NextA;      // array of size nb_var: next variable in the active list (or 0 if the
+                     // variable isn't active)
 } activelist_t;
 
+// type for the variable order used by the VSIDS heuristic: unassigned variables are kept in a
+// binary heap, the variable with highest activity on top
+typedef struct {
+    int nb_var;       // number of variables
+    double* Activity; // array of size nb_var+1: activity of each variable
+    double inc;       // amount added to the activity of a variable when it is bumped
+    double decay;     // after each conflict, inc is divided by decay (older bumps count less)
+    int* Heap;        // array of size nb_var: the heap (children of i are 2*i+1 and 2*i+2)
+    int* Pos;         // array of size nb_var+1: position of each variable in the heap (or EOL)
+    int size;         // number of variables in the heap
+} order_t;
+
+// type for the clauses exported by a thread of the portfolio: a ring buffer with a single writer
+// (the thread) and several readers (the other threads), where each clause is stored as its size
+// followed by its literals. Readers that are too late lose the clauses that were overwritten.
+typedef struct {
+    int* Buf;           // array of SHARE_RING words
+    unsigned long head; // number of words written so far (only modified by the writer)
+} ring_t;
+
+// type for the clauses shared by the threads of the portfolio
+typedef struct {
+    int nb_threads;
+    ring_t* Ring; // array of size nb_threads: the ring of each thread
+} share_t;
+
+// type for the CDCL engine
+typedef struct {
+    formula_t* F;         // formula (not modified: its clauses are copied in the arena)
+    sol_t* S;             // current assignment: S->Var is the trail, and S->n its size
+    char* Val;            // array of size 2*nb_var+2: value (TRUE, FALSE or UNSET) of each literal
+    int* Level;           // array of size nb_var+1: decision level of each assigned variable
+    int* Reason;          // array of size nb_var+1: clause that forced each variable (or EOL)
+    int* TrailLim;        // array of size nb_var+1: position in the trail where each level starts
+    int level;            // current decision level
+    int qhead;            // position in the trail of the next assignment to propagate
+    arena_t* A;           // clause arena, with the clauses of the formula and the learned ones
+    watchlist_t* W;       // watch lists (watchers give the references of clauses in the arena)
+    order_t* O;           // variable order (VSIDS), or NULL to take variables in increasing order
+    char* Seen;           // array of size nb_var+1, used during conflict analysis
+    int* Learnt;          // array of size nb_var+1: clause being learned
+    int* Learnts;         // references of the learned clauses that haven't been deleted
+    int nb_learnts;       // number of learned clauses in Learnts
+    int size_learnts;     // allocated size of Learnts
+    double cla_inc;       // amount added to the activity of a learned clause when it is bumped
+    long next_reduce;     // the learned clauses are reduced when there are that many conflicts
+    int* Stamp;           // array of size nb_var+1, used to compute the LBD of learned clauses
+    int stamp;            // current stamp
+    int next_var;         // all the variables before next_var are assigned
+    char* Phase;          // array of size nb_var+1: saved polarity of each variable
+    int phase_saving;     // reuse the last polarity of variables for decisions?
+    int restart;          // restart policy (RESTART_NONE, RESTART_LUBY or RESTART_EMA)
+    int luby_unit;        // number of conflicts corresponding to 1 in the Luby sequence
+    long restart_conflicts; // number of conflicts since the last restart
+    long max_conflicts;   // the search is interrupted after this number of conflicts (-1: never)
+    int* Stop;            // if not NULL, the search is interrupted as soon as *Stop becomes non 0
+    double ema_fast;      // moving averages of the decision level of conflicts, over the last
+    double ema_slow;      // ~32 and ~4096 conflicts
+    int unsat;            // set when the formula is known to be unsatisfiable
+    long nb_decisions;    // statistics...
+    long nb_conflicts;
+    long nb_propagations;
+    long nb_learnt;
+    long nb_restarts;
+    share_t* Share;       // clauses shared with other threads (or NULL)
+    int share_id;         // number of the thread
+    unsigned long* Read;  // array of size Share->nb_threads: position in the ring of each thread
+    int exported;         // the units of the trail before this position were exported
+    long nb_reductions;
+    long nb_deleted;
+    long nb_exported;
+    long nb_imported;
+    int* Assumptions;     // literals decided first, at levels 1, 2, ... (set by set_assumptions())
+    int nb_assumptions;
+    int* Failed;          // when unsatisfiable under the assumptions: the assumptions responsible
+    int nb_failed;
+    int max_level;        // TrailLim and Stamp are of size max_level+1
+    long next_vivify;     // the clauses are vivified at the first restart after that many conflicts
+    int vivify_next;      // reference of the next clause to vivify in the arena
+    long vivify_props;    // propagations spent in vivification (included in nb_propagations)
+    long nb_vivified;     // number of shortened clauses
+    long nb_vivified_lits;
+} cdcl_t;
+
+// type for the solvers of the library interface: a CDCL engine kept between calls
+typedef struct {
+    formula_t* F;   // copy of the initial formula
+    sol_t* S;       // assignment of the engine
+    order_t* O;     // variable order of the engine
+    cdcl_t* C;      // the engine, with all the clauses added so far
+    char* Model;    // array of size nb_var+1: value of each variable in the last model (or UNSET)
+    int* Failed;    // failed assumptions of the last call (DIMACS literals)
+    int nb_failed;
+    int* Decisions; // decisions of the last model (DIMACS literals)
+    int nb_decisions;
+} solver_t;
+
 //////////////////////////
 // boring global variables
 extern int VERBOSE;
 extern int BUF_SIZE;
+extern int RESTART;
+extern int LUBY_UNIT;
+extern int PHASE_SAVING;
+extern int PURE_LITERALS;
+extern int LOOKAHEAD;
+extern int NB_THREADS;
 
 ///////////////////////////////
 // prototypes for the functions
@@ -92,22 +359,80 @@ extern int BUF_SIZE;
 // utils.c file
 void LOG(int v, char* format, ...);
 /* int trim_blanks(char** buf); */
-/* int parse_name_from_comment(char* line, char* name); */
+int parse_name_from_comment(char* line, char* name);
 
 formula_t* parse_formula(FILE* f_in);
+formula_t* copy_formula(formula_t* F);
 void free_formula(formula_t* F);
 
+watchlist_t* new_watchlist(int nb_var, int nb_cl);
 watchlist_t* init_watchlists(formula_t* F);
 void free_watchlist(watchlist_t* W);
+void add_watcher(watchlist_t* W, int lit, int cl, int blocker);
+
+occurrences_t* new_occurrences(formula_t* F);
+void free_occurrences(occurrences_t* O);
+
+pure_t* new_pure(formula_t* F, sol_t* S);
+void free_pure(pure_t* P);
+void assign_pure(formula_t* F, pure_t* P, int lit);
+void unassign_pure(formula_t* F, pure_t* P, int lit);
+int next_pure_literal(formula_t* F, sol_t* S, pure_t* P);
 
 activelist_t* init_activelist(formula_t* F, watchlist_t* W);
 void free_activelist(activelist_t* A);
 int is_active(activelist_t* A, int var);
 
+order_t* new_order(int nb_var);
+void free_order(order_t* O);
+int in_order(order_t* O, int var);
+void insert_order(order_t* O, int var);
+int pop_order(order_t* O);
+void bump_order(order_t* O, int var);
+void decay_order(order_t* O);
+
+arena_t* new_arena(int cap);
+void free_arena(arena_t* A);
+int alloc_clause(arena_t* A, int* lits, int size, int learnt);
+void delete_clause(arena_t* A, int cr);
+
 sol_t* new_sol(int n);
 void free_sol(sol_t* S);
+extension_t* new_extension();
+void free_extension(extension_t* E);
+void push_extension(extension_t* E, int* lits, int size, int pivot);
+void extend_solution(extension_t* E, sol_t* S, int nb_var);
 
+void compact_CNF(formula_t* F, sol_t* S, int* Map);
 void simplify_CNF(formula_t* F, sol_t* S);
+void append_clauses(formula_t* F, int* Cl, int* Lit, int nb_cl, int nb_lit);
+
+// file dimacs.c
+formula_t* load_formula(char* filename);
+
+// file cards.c
+void normalize_cards(formula_t* F);
+void expand_cards(formula_t* F);
+int find_cards(formula_t* F);
+cardlist_t* new_cardlist(formula_t* F);
+void free_cardlist(cardlist_t* K);
+int assign_cards(formula_t* F, sol_t* S, cardlist_t* K, int lit);
+void unassign_cards(cardlist_t* K, int lit);
+int next_card_literal(sol_t* S, cardlist_t* K);
+int unset_card_var(sol_t* S, cardlist_t* K);
+
+// file gauss.c
+void normalize_xors(formula_t* F);
+void expand_xors(formula_t* F);
+gauss_t* new_gauss(formula_t* F);
+void free_gauss(gauss_t* G);
+int assign_gauss(gauss_t* G, int lit);
+void unassign_gauss(gauss_t* G, int lit);
+int next_gauss_literal(sol_t* S, gauss_t* G);
+int unset_gauss_var(gauss_t* G);
+
+// file brute.c
+int solve_brute(formula_t* F, sol_t* S, unsigned long long* count);
 
 // file print.c
 void print_struct_formula(formula_t* F);
@@ -122,13 +447,18 @@ void print_negated_solution(formula_t* F, sol_t* S);
 
 // file naive.c
 int solve_naive(formula_t* F, sol_t* S);
-int backtrack_naive(sol_t* S);
+int backtrack_naive(sol_t* S, occurrences_t* O, int* NonFalse);
 int is_non_false(formula_t* F, sol_t* S);
 
 // file solve.c
 int is_solution(formula_t* F, sol_t* S);
-int solve(formula_t* F, sol_t* S, watchlist_t* W, activelist_t* A, int BCP);
-int backtrack(sol_t* S, watchlist_t* W, activelist_t* A);
+int solve(formula_t* F, sol_t* S, watchlist_t* W, activelist_t* A, order_t* O, int BCP);
+int choose_var(sol_t* S, activelist_t* A, order_t* O);
+int choose_lookahead(formula_t* F, sol_t* S, watchlist_t* W, activelist_t* A, cardlist_t* K,
+    gauss_t* G, int* forced);
+int simplify_top_level(formula_t* F, sol_t* S, watchlist_t* W, activelist_t* A);
+int backtrack(formula_t* F, sol_t* S, watchlist_t* W, activelist_t* A, order_t* O, pure_t* P,
+    cardlist_t* K, gauss_t* G);
 int update_watch_lists(formula_t* F, sol_t* S, watchlist_t* W, activelist_t* A, int lit);
 int new_watching_literal(formula_t* F, sol_t* S, int cl);
 
@@ -137,6 +467,7 @@ int is_unit(formula_t* F, sol_t* S, int cl);
 int is_empty_active(activelist_t* A);
 void push_active(int var, activelist_t* A);
 int pop_active(activelist_t* A);
+int first_active(sol_t* S, activelist_t* A);
 int preprocess(formula_t* F, sol_t* S);
 
 void LOG_sol(sol_t* S);
@@ -147,6 +478,64 @@ int check_watchlists(formula_t* F, sol_t* S, watchlist_t* W);
 int check_activelist(formula_t* F, sol_t* S, watchlist_t* W, activelist_t* A);
 int check_sanity(formula_t* F, sol_t* S, watchlist_t* W, activelist_t* A);
 
+// file cdcl.c
+cdcl_t* new_cdcl(formula_t* F, sol_t* S, order_t* O);
+void free_cdcl(cdcl_t* C);
+int run_cdcl(cdcl_t* C);
+int solve_cdcl(formula_t* F, sol_t* S, order_t* O);
+int import_clause(cdcl_t* C, int* lits, int size);
+int propagate_pending(cdcl_t* C);
+int push_decision(cdcl_t* C, int lit);
+void pop_decision(cdcl_t* C);
+int add_formula_clause(cdcl_t* C, int* lits, int size);
+void set_assumptions(cdcl_t* C, int* lits, int n);
+
+// file portfolio.c
+void export_clause(cdcl_t* C, int* lits, int size);
+int exchange_clauses(cdcl_t* C);
+int solve_portfolio(formula_t* F, sol_t* S);
+
+// file components.c
+int find_components(formula_t* F, int* Comp);
+formula_t* component_formula(formula_t* F, int* Comp, int c, int* Map);
+formula_t* formula_with_unit(formula_t* F, int lit);
+int solve_components(formula_t* F, sol_t* S);
+
+// file simplify.c
+simp_t* new_simp(formula_t* F);
+void free_simp(simp_t* P);
+int simp_add_clause(simp_t* P, int* lits, int size);
+void simp_delete_clause(simp_t* P, int cl);
+int simp_occurrences(simp_t* P, int lit);
+void simp_to_formula(simp_t* P, formula_t* F);
+int subsume_clauses(simp_t* P, int* nb_removed_lits);
+int eliminate_variables(simp_t* P, extension_t* E);
+int eliminate_blocked(simp_t* P, extension_t* E);
+int remove_blocked_clauses(formula_t* F, sol_t* S, extension_t* E);
+int simplify_formula(formula_t* F, sol_t* S, extension_t* E);
+
+// file probe.c
+int probe_formula(formula_t* F, sol_t* S, extension_t* E);
+
+// file count.c
+char* count_models(formula_t* F, sol_t* S);
+
+// file cube.c
+int solve_cubes(formula_t* F, sol_t* S);
+
+// file solver.c (library interface, literals are given as in DIMACS files)
+solver_t* new_solver(formula_t* F);
+void free_solver(solver_t* L);
+int solver_add_clause(solver_t* L, int* lits, int size);
+int solver_solve(solver_t* L, int* assumptions, int n);
+int solver_value(solver_t* L, int var);
+int solver_decisions(solver_t* L, int** lits);
+int solver_failed(solver_t* L, int** lits);
+
+// file enumerate.c
+int* parse_var_list(char* list, int nb_var, int* n);
+long enumerate_models(formula_t* F, int* Project, int nb_project, long max, int quiet);
+
 // file test.c
 int test(char* cmd, int argc, char** argv);
 
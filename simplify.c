@@ -0,0 +1,661 @@
+#include "sat.h"
+
+// Simplification of the formula before the search (with -P).
+//
+// Bounded variable elimination (as in SatELite): a variable x is eliminated by replacing the
+// clauses containing x or -x by all their non tautological resolvents on x. The new formula is
+// satisfiable iff the initial one is, and the elimination is only done when it doesn't increase
+// the number of clauses. The removed clauses are kept on a reconstruction stack (extension_t),
+// which gives a value to the eliminated variables once the simplified formula is solved.
+//
+// Subsumption: a clause D subsumes a clause C when D is included in C, and C can be removed. When
+// D is included in C except for one literal whose negation is in C, the resolvent of C and D
+// subsumes C, and this literal is removed from C (self-subsuming resolution). A 64 bit signature
+// of the variables of each clause rejects most candidates without looking at the literals.
+//
+// Blocked clauses (with -B): a clause C is blocked on one of its literals l when all the
+// resolvents of C on l are tautologies. Removing C keeps the formula satisfiable, and a solution
+// of the new formula where C is false becomes a solution of the initial one by making l true:
+// C is pushed on the reconstruction stack with l as its pivot.
+
+// variables with more occurrences than this in both polarities are not eliminated
+#define BVE_OCC_LIMIT 10
+// no resolvent longer than this
+#define BVE_CLAUSE_LIMIT 20
+// maximal number of passes over the variables
+#define BVE_ROUNDS 3
+// literals whose negation has more occurrences than this are not tried as blocking literals
+#define BCE_OCC_LIMIT 100
+// maximal number of passes over the literals
+#define BCE_ROUNDS 3
+
+//////////////////////////////
+// dynamic set of clauses
+
+// add a clause in the occurrence list of a literal
+static void add_occurrence(simp_t* P, int lit, int cl)
+{
+    if (P->nb_occ[lit] == P->cap_occ[lit]) {
+        P->cap_occ[lit] *= 2;
+        P->Occ[lit] = realloc(P->Occ[lit], P->cap_occ[lit] * sizeof(int));
+    }
+    P->Occ[lit][P->nb_occ[lit]++] = cl;
+}
+
+// add a clause (the literals are copied)
+// returns the index of the clause
+int simp_add_clause(simp_t* P, int* lits, int size)
+{
+    if (P->nb_cl == P->cap_cl) {
+        P->cap_cl *= 2;
+        P->Start = realloc(P->Start, P->cap_cl * sizeof(int));
+        P->Size = realloc(P->Size, P->cap_cl * sizeof(int));
+        P->Signature = realloc(P->Signature, P->cap_cl * sizeof(unsigned long long));
+        P->Deleted = realloc(P->Deleted, P->cap_cl * sizeof(char));
+    }
+    while (P->nb_lit + size > P->cap_lit) {
+        P->cap_lit *= 2;
+        P->Lit = realloc(P->Lit, P->cap_lit * sizeof(int));
+    }
+    int cl = P->nb_cl++;
+    P->Start[cl] = P->nb_lit;
+    memcpy(P->Lit + P->nb_lit, lits, size * sizeof(int));
+    P->nb_lit += size;
+    P->Size[cl] = size;
+    P->Signature[cl] = 0;
+    P->Deleted[cl] = 0;
+    for (int i = 0; i < size; i++) {
+        P->Signature[cl] |= 1ULL << (VARIABLE(lits[i]) & 63);
+        add_occurrence(P, lits[i], cl);
+        P->Touched[VARIABLE(lits[i])] = 1;
+    }
+    return cl;
+}
+
+// delete a clause (it stays in the occurrence lists until they are cleaned)
+void simp_delete_clause(simp_t* P, int cl)
+{
+    if (P->Deleted[cl]) {
+        return;
+    }
+    P->Deleted[cl] = 1;
+    P->nb_deleted++;
+    for (int i = 0; i < P->Size[cl]; i++) {
+        P->Touched[VARIABLE(P->Lit[P->Start[cl] + i])] = 1;
+    }
+}
+
+// remove the deleted clauses from the occurrence list of a literal
+// returns the number of clauses containing the literal
+int simp_occurrences(simp_t* P, int lit)
+{
+    int n = 0;
+    for (int i = 0; i < P->nb_occ[lit]; i++) {
+        if (!P->Deleted[P->Occ[lit][i]]) {
+            P->Occ[lit][n++] = P->Occ[lit][i];
+        }
+    }
+    P->nb_occ[lit] = n;
+    return n;
+}
+
+// create the dynamic set of clauses of a formula
+simp_t* new_simp(formula_t* F)
+{
+    simp_t* P = malloc(sizeof(simp_t));
+    P->nb_var = F->nb_var;
+    P->nb_cl = 0;
+    P->cap_cl = F->nb_cl > 16 ? F->nb_cl : 16;
+    P->nb_deleted = 0;
+    P->nb_lit = 0;
+    P->cap_lit = F->nb_lit > 16 ? 2 * F->nb_lit : 32;
+    P->Lit = malloc(P->cap_lit * sizeof(int));
+    P->Start = malloc(P->cap_cl * sizeof(int));
+    P->Size = malloc(P->cap_cl * sizeof(int));
+    P->Signature = malloc(P->cap_cl * sizeof(unsigned long long));
+    P->Deleted = malloc(P->cap_cl * sizeof(char));
+    P->Occ = malloc((2 * F->nb_var + 2) * sizeof(int*));
+    P->nb_occ = calloc(2 * F->nb_var + 2, sizeof(int));
+    P->cap_occ = calloc(2 * F->nb_var + 2, sizeof(int));
+    // the occurrence lists are allocated once with some room for the resolvents
+    for (int i = 0; i < F->nb_lit; i++) {
+        P->cap_occ[F->Lit[i]]++;
+    }
+    for (int lit = 0; lit < 2 * F->nb_var + 2; lit++) {
+        P->cap_occ[lit] += 4;
+        P->Occ[lit] = malloc(P->cap_occ[lit] * sizeof(int));
+    }
+    P->Touched = calloc(F->nb_var + 1, sizeof(char));
+    // repeated literals are removed, and tautologies are ignored
+    char* Mark = calloc(2 * F->nb_var + 2, sizeof(char));
+    int* Lits = malloc((F->nb_var + 1) * sizeof(int));
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        int size = 0;
+        int tautology = 0;
+        for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+            int lit = F->Lit[i];
+            tautology |= Mark[lit ^ 1];
+            if (!Mark[lit]) {
+                Mark[lit] = 1;
+                Lits[size++] = lit;
+            }
+        }
+        for (int i = 0; i < size; i++) {
+            Mark[Lits[i]] = 0;
+        }
+        if (!tautology) {
+            simp_add_clause(P, Lits, size);
+        }
+    }
+    free(Mark);
+    free(Lits);
+    return P;
+}
+
+// free a dynamic set of clauses
+void free_simp(simp_t* P)
+{
+    if (P == NULL)
+        return;
+    for (int lit = 0; lit < 2 * P->nb_var + 2; lit++) {
+        free(P->Occ[lit]);
+    }
+    free(P->Lit);
+    free(P->Start);
+    free(P->Size);
+    free(P->Signature);
+    free(P->Deleted);
+    free(P->Occ);
+    free(P->nb_occ);
+    free(P->cap_occ);
+    free(P->Touched);
+    free(P);
+}
+
+// replace the clauses of a formula by the remaining clauses of the dynamic set
+void simp_to_formula(simp_t* P, formula_t* F)
+{
+    int nb_cl = 0;
+    int nb_lit = 0;
+    for (int cl = 0; cl < P->nb_cl; cl++) {
+        if (!P->Deleted[cl]) {
+            nb_cl++;
+            nb_lit += P->Size[cl];
+        }
+    }
+    free(F->Lit);
+    free(F->Cl);
+    F->Lit = malloc((nb_lit + 1) * sizeof(int));
+    F->Cl = malloc((nb_cl + 1) * sizeof(int));
+    F->nb_cl = 0;
+    F->nb_lit = 0;
+    F->Cl[0] = 0;
+    for (int cl = 0; cl < P->nb_cl; cl++) {
+        if (P->Deleted[cl]) {
+            continue;
+        }
+        memcpy(F->Lit + F->nb_lit, P->Lit + P->Start[cl], P->Size[cl] * sizeof(int));
+        F->nb_lit += P->Size[cl];
+        F->Cl[++F->nb_cl] = F->nb_lit;
+    }
+}
+
+//////////////////////////////
+// subsumption
+
+// compare a clause D with the clause C whose literals are marked in Mark
+// returns EOL if D doesn't subsume C, the literal of C to remove if the resolvent of C and D
+// subsumes C, and 0 if D subsumes C
+static int subsumes(simp_t* P, int d, char* Mark)
+{
+    int removed = 0;
+    int* Lits = P->Lit + P->Start[d];
+    for (int i = 0; i < P->Size[d]; i++) {
+        if (Mark[Lits[i]]) {
+            continue;
+        }
+        if (!Mark[Lits[i] ^ 1] || removed != 0) {
+            return EOL;
+        }
+        removed = Lits[i] ^ 1;
+    }
+    return removed;
+}
+
+// watch a clause in a one-watch list
+static void add_watch(int** Watch, int* nb_watch, int* cap_watch, int lit, int cl)
+{
+    if (nb_watch[lit] == cap_watch[lit]) {
+        cap_watch[lit] = cap_watch[lit] == 0 ? 4 : 2 * cap_watch[lit];
+        Watch[lit] = realloc(Watch[lit], cap_watch[lit] * sizeof(int));
+    }
+    Watch[lit][nb_watch[lit]++] = cl;
+}
+
+// remove the subsumed clauses, and strengthen the clauses by self-subsuming resolution
+// the clauses are taken by increasing size, and compared with the smaller clauses already seen:
+// those are watched by one of their literals (the one with the fewest watched clauses), so that a
+// clause that may subsume C is watched by a literal of C or by its negation
+// stores the number of removed literals in *nb_removed_lits, and returns the number of removed
+// clauses, or -1 if the empty clause is found
+int subsume_clauses(simp_t* P, int* nb_removed_lits)
+{
+    int nb_lits = 2 * P->nb_var + 2;
+    int** Watch = calloc(nb_lits, sizeof(int*));
+    int* nb_watch = calloc(nb_lits, sizeof(int));
+    int* cap_watch = calloc(nb_lits, sizeof(int));
+    char* Mark = calloc(nb_lits, sizeof(char));
+    int* Lits = malloc((P->nb_var + 1) * sizeof(int));
+    int nb_subsumed = 0;
+    *nb_removed_lits = 0;
+
+    // counting sort of the clauses by size
+    int max_size = 0;
+    for (int cl = 0; cl < P->nb_cl; cl++) {
+        if (!P->Deleted[cl] && P->Size[cl] > max_size) {
+            max_size = P->Size[cl];
+        }
+    }
+    int* Count = calloc(max_size + 2, sizeof(int));
+    int nb_cl = 0;
+    for (int cl = 0; cl < P->nb_cl; cl++) {
+        if (!P->Deleted[cl]) {
+            Count[P->Size[cl] + 1]++;
+            nb_cl++;
+        }
+    }
+    for (int k = 1; k <= max_size + 1; k++) {
+        Count[k] += Count[k - 1];
+    }
+    int* Order = malloc((nb_cl + 1) * sizeof(int));
+    for (int cl = 0; cl < P->nb_cl; cl++) {
+        if (!P->Deleted[cl]) {
+            Order[Count[P->Size[cl]]++] = cl;
+        }
+    }
+
+    int unsat = 0;
+    for (int k = 0; k < nb_cl && !unsat; k++) {
+        int c = Order[k];
+        int size = P->Size[c];
+        if (size == 0) {
+            unsat = 1;
+            break;
+        }
+        memcpy(Lits, P->Lit + P->Start[c], size * sizeof(int));
+        unsigned long long signature = P->Signature[c];
+        for (int i = 0; i < size; i++) {
+            Mark[Lits[i]] = 1;
+        }
+
+        // compare with the clauses watched by the literals of C and by their negations
+        int subsumed = 0;
+        int strengthened = 0;
+        for (int i = 0; i < 2 * size && !subsumed; i++) {
+            int lit = Lits[i / 2] ^ (i & 1);
+            for (int j = 0; j < nb_watch[lit]; j++) {
+                int d = Watch[lit][j];
+                if (P->Deleted[d] || (P->Signature[d] & ~signature) != 0) {
+                    continue;
+                }
+                int removed = subsumes(P, d, Mark);
+                if (removed == 0) {
+                    subsumed = 1;
+                    break;
+                }
+                if (removed != EOL) {
+                    // the literal is removed, and C is compared again from the start
+                    Mark[removed] = 0;
+                    int n = 0;
+                    signature = 0;
+                    for (int l = 0; l < size; l++) {
+                        if (Lits[l] != removed) {
+                            Lits[n++] = Lits[l];
+                            signature |= 1ULL << (VARIABLE(Lits[l]) & 63);
+                        }
+                    }
+                    size = n;
+                    strengthened++;
+                    i = -1;
+                    break;
+                }
+            }
+        }
+        for (int i = 0; i < size; i++) {
+            Mark[Lits[i]] = 0;
+        }
+
+        if (subsumed) {
+            simp_delete_clause(P, c);
+            nb_subsumed++;
+            continue;
+        }
+        if (strengthened > 0) {
+            *nb_removed_lits += strengthened;
+            if (size == 0) {
+                unsat = 1;
+                break;
+            }
+            simp_delete_clause(P, c);
+            c = simp_add_clause(P, Lits, size);
+        }
+        int best = Lits[0];
+        for (int i = 1; i < size; i++) {
+            if (nb_watch[Lits[i]] < nb_watch[best]) {
+                best = Lits[i];
+            }
+        }
+        add_watch(Watch, nb_watch, cap_watch, best, c);
+    }
+
+    for (int lit = 0; lit < nb_lits; lit++) {
+        free(Watch[lit]);
+    }
+    free(Watch);
+    free(nb_watch);
+    free(cap_watch);
+    free(Mark);
+    free(Lits);
+    free(Count);
+    free(Order);
+    return unsat ? -1 : nb_subsumed;
+}
+
+//////////////////////////////
+// variable elimination
+
+// resolvent of two clauses on a variable, stored in Res (of size BVE_CLAUSE_LIMIT+1)
+// the clauses are short: repeated literals are found by going through the resolvent
+// returns the size of the resolvent (more than BVE_CLAUSE_LIMIT if it is too long), or EOL if it
+// is a tautology
+static int resolve(simp_t* P, int c1, int c2, int x, int* Res)
+{
+    int size = 0;
+    int* Lits1 = P->Lit + P->Start[c1];
+    int* Lits2 = P->Lit + P->Start[c2];
+    for (int i = 0; i < P->Size[c1]; i++) {
+        int lit = Lits1[i];
+        if (VARIABLE(lit) == x) {
+            continue;
+        }
+        if (size == BVE_CLAUSE_LIMIT) {
+            return size + 1;
+        }
+        Res[size++] = lit;
+    }
+    int size1 = size;
+    for (int i = 0; i < P->Size[c2]; i++) {
+        int lit = Lits2[i];
+        if (VARIABLE(lit) == x) {
+            continue;
+        }
+        int k;
+        for (k = 0; k < size1; k++) {
+            if ((Res[k] | 1) == (lit | 1)) {
+                break;
+            }
+        }
+        if (k < size1) {
+            if (Res[k] != lit) {
+                return EOL;
+            }
+            continue;
+        }
+        if (size == BVE_CLAUSE_LIMIT) {
+            return size + 1;
+        }
+        Res[size++] = lit;
+    }
+    return size;
+}
+
+// try to eliminate a variable
+// returns 1 if it is eliminated, 0 if not, and -1 if an empty resolvent is found
+static int eliminate_var(simp_t* P, extension_t* E, int x, int* Res)
+{
+    int pos = 2 * x + 1;
+    int neg = 2 * x;
+    int np = simp_occurrences(P, pos);
+    int nn = simp_occurrences(P, neg);
+    if (np + nn == 0 || (np > BVE_OCC_LIMIT && nn > BVE_OCC_LIMIT)) {
+        return 0;
+    }
+
+    // the number of resolvents must not exceed the number of removed clauses
+    int nb_res = 0;
+    for (int i = 0; i < np; i++) {
+        for (int j = 0; j < nn; j++) {
+            int size = resolve(P, P->Occ[pos][i], P->Occ[neg][j], x, Res);
+            if (size == EOL) {
+                continue;
+            }
+            if (size > BVE_CLAUSE_LIMIT || ++nb_res > np + nn) {
+                return 0;
+            }
+        }
+    }
+
+    // the removed clauses are needed to extend the solution
+    for (int i = 0; i < np; i++) {
+        int cl = P->Occ[pos][i];
+        push_extension(E, P->Lit + P->Start[cl], P->Size[cl], pos);
+    }
+    for (int j = 0; j < nn; j++) {
+        int cl = P->Occ[neg][j];
+        push_extension(E, P->Lit + P->Start[cl], P->Size[cl], neg);
+    }
+    for (int i = 0; i < np; i++) {
+        for (int j = 0; j < nn; j++) {
+            int size = resolve(P, P->Occ[pos][i], P->Occ[neg][j], x, Res);
+            if (size == 0) {
+                return -1;
+            }
+            if (size != EOL) {
+                simp_add_clause(P, Res, size);
+            }
+        }
+    }
+    for (int i = 0; i < np; i++) {
+        simp_delete_clause(P, P->Occ[pos][i]);
+    }
+    for (int j = 0; j < nn; j++) {
+        simp_delete_clause(P, P->Occ[neg][j]);
+    }
+    P->nb_occ[pos] = 0;
+    P->nb_occ[neg] = 0;
+    return 1;
+}
+
+// eliminate the variables whose elimination doesn't increase the number of clauses, starting with
+// the variables with the fewest occurrences
+// after the first pass, only the variables whose clauses have changed are tried again
+// returns the number of eliminated variables, or -1 if the formula is unsatisfiable
+int eliminate_variables(simp_t* P, extension_t* E)
+{
+    int n = P->nb_var;
+    int* Res = malloc((BVE_CLAUSE_LIMIT + 1) * sizeof(int));
+    char* Eliminated = calloc(n + 1, sizeof(char));
+    int* Vars = malloc(n * sizeof(int));
+    int* Occ = malloc((n + 1) * sizeof(int));
+    int* Count = malloc((n + 2) * sizeof(int));
+    int nb_eliminated = 0;
+    for (int x = 1; x <= n; x++) {
+        P->Touched[x] = 1;
+    }
+
+    for (int round = 0; round < BVE_ROUNDS; round++) {
+        // counting sort of the touched variables by number of occurrences (clamped to n)
+        for (int k = 0; k <= n + 1; k++) {
+            Count[k] = 0;
+        }
+        for (int x = 1; x <= n; x++) {
+            if (!Eliminated[x] && P->Touched[x]) {
+                Occ[x] = simp_occurrences(P, 2 * x) + simp_occurrences(P, 2 * x + 1);
+                if (Occ[x] > n) {
+                    Occ[x] = n;
+                }
+                Count[Occ[x] + 1]++;
+            }
+        }
+        for (int k = 1; k <= n + 1; k++) {
+            Count[k] += Count[k - 1];
+        }
+        int nb_vars = 0;
+        for (int x = 1; x <= n; x++) {
+            if (!Eliminated[x] && P->Touched[x]) {
+                Vars[Count[Occ[x]]++] = x;
+                P->Touched[x] = 0;
+                nb_vars++;
+            }
+        }
+
+        int progress = 0;
+        for (int i = 0; i < nb_vars; i++) {
+            int r = eliminate_var(P, E, Vars[i], Res);
+            if (r == -1) {
+                nb_eliminated = -1;
+                break;
+            }
+            if (r == 1) {
+                Eliminated[Vars[i]] = 1;
+                nb_eliminated++;
+                progress = 1;
+            }
+        }
+        LOG(2, "round %d of variable elimination: %d variable(s) eliminated so far\n", round + 1,
+            nb_eliminated);
+        if (nb_eliminated == -1 || !progress) {
+            break;
+        }
+    }
+    free(Res);
+    free(Eliminated);
+    free(Vars);
+    free(Occ);
+    free(Count);
+    return nb_eliminated;
+}
+
+//////////////////////////////
+// blocked clauses
+
+// is the clause C, whose literals are marked in Mark, blocked on its literal lit?
+static int is_blocked(simp_t* P, int lit, char* Mark)
+{
+    for (int j = 0; j < P->nb_occ[lit ^ 1]; j++) {
+        int d = P->Occ[lit ^ 1][j];
+        if (P->Deleted[d]) {
+            continue;
+        }
+        // the resolvent must contain a literal and its negation (other than lit and -lit)
+        int* Lits = P->Lit + P->Start[d];
+        int k;
+        for (k = 0; k < P->Size[d]; k++) {
+            if (Lits[k] != (lit ^ 1) && Mark[Lits[k] ^ 1]) {
+                break;
+            }
+        }
+        if (k == P->Size[d]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// remove the blocked clauses: removing a clause may block other clauses, so that this is done
+// again while clauses are removed
+// returns the number of removed clauses
+int eliminate_blocked(simp_t* P, extension_t* E)
+{
+    char* Mark = calloc(2 * P->nb_var + 2, sizeof(char));
+    int nb_blocked = 0;
+    for (int round = 0; round < BCE_ROUNDS; round++) {
+        int progress = 0;
+        for (int lit = 2; lit < 2 * P->nb_var + 2; lit++) {
+            if (simp_occurrences(P, lit ^ 1) > BCE_OCC_LIMIT) {
+                continue;
+            }
+            int np = simp_occurrences(P, lit);
+            for (int i = 0; i < np; i++) {
+                int c = P->Occ[lit][i];
+                if (P->Deleted[c]) {
+                    continue;
+                }
+                int* Lits = P->Lit + P->Start[c];
+                for (int k = 0; k < P->Size[c]; k++) {
+                    Mark[Lits[k]] = 1;
+                }
+                int blocked = is_blocked(P, lit, Mark);
+                for (int k = 0; k < P->Size[c]; k++) {
+                    Mark[Lits[k]] = 0;
+                }
+                if (blocked) {
+                    push_extension(E, Lits, P->Size[c], lit);
+                    simp_delete_clause(P, c);
+                    nb_blocked++;
+                    progress = 1;
+                }
+            }
+        }
+        LOG(2, "round %d of blocked clause elimination: %d clause(s) removed so far\n", round + 1,
+            nb_blocked);
+        if (!progress) {
+            break;
+        }
+    }
+    free(Mark);
+    return nb_blocked;
+}
+
+// remove the blocked clauses of a formula (after the unit propagation of preprocess())
+// the removed clauses are pushed on E, to extend the solution with extend_solution()
+// returns -1 if the formula is unsatisfiable, 1 if it is satisfied by S, and 0 otherwise
+int remove_blocked_clauses(formula_t* F, sol_t* S, extension_t* E)
+{
+    int nb_cl = F->nb_cl;
+    simp_t* P = new_simp(F);
+    int nb_blocked = eliminate_blocked(P, E);
+    simp_to_formula(P, F);
+    free_simp(P);
+    LOG(1, "%d blocked clause(s) removed, %d clause(s) instead of %d\n", nb_blocked, F->nb_cl,
+        nb_cl);
+    return preprocess(F, S);
+}
+
+// simplify a formula after the unit propagation of preprocess(): the equivalent literals are
+// replaced, the failed literals, the subsumed clauses and the eliminated variables are removed,
+// and the unit clauses found on the way are propagated
+// the removed clauses are pushed on E, to extend the solution with extend_solution()
+// returns -1 if the formula is unsatisfiable, 1 if it is satisfied by S, and 0 otherwise
+int simplify_formula(formula_t* F, sol_t* S, extension_t* E)
+{
+    int nb_cl = F->nb_cl;
+    int nb_lit = F->nb_lit;
+    int r = probe_formula(F, S, E);
+    if (r != 0) {
+        return r;
+    }
+    simp_t* P = new_simp(F);
+    int nb_lits1, nb_lits2;
+    int nb_subsumed = subsume_clauses(P, &nb_lits1);
+    int nb_eliminated = nb_subsumed == -1 ? -1 : eliminate_variables(P, E);
+    // the resolvents are often subsumed
+    int nb_subsumed2 = 0;
+    nb_lits2 = 0;
+    if (nb_eliminated != 0) {
+        nb_subsumed2 = nb_eliminated == -1 ? -1 : subsume_clauses(P, &nb_lits2);
+    }
+    if (nb_subsumed2 == -1) {
+        free_simp(P);
+        return -1;
+    }
+    simp_to_formula(P, F);
+    free_simp(P);
+    LOG(1, "%d clause(s) subsumed, %d literal(s) removed by self-subsuming resolution\n",
+        nb_subsumed + nb_subsumed2, nb_lits1 + nb_lits2);
+    LOG(1, "%d variable(s) eliminated, %d clause(s) instead of %d, %d literal(s) instead of %d\n",
+        nb_eliminated, F->nb_cl, nb_cl, F->nb_lit, nb_lit);
+    return preprocess(F, S);
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
@@ -17,9 +17,8 @@ int is_solution(formula_t *F, sol_t *S) {
         for (int j = F->Cl[i]; j < F->Cl[i + 1]; ++j) {
             int state = S->State[VARIABLE(F->Lit[j])];
             int sign = SIGN(F->Lit[j]);
-            if (sign && (state == TRUE || state == TRUE_WAS_FALSE)) {
-                t = 1;
-            } else if (!sign && (state == FALSE || state == FALSE_WAS_TRUE)) {
+            // forced values count as well: only the parity of the state gives the value
+            if (state != UNSET && (state & 1) == sign) {
                 t = 1;
             }
         }
@@ -27,6 +26,33 @@ int is_solution(formula_t *F, sol_t *S) {
             return 0;
         }
     }
+    // the cardinality constraints can't have more true literals than their bound
+    for (int c = 0; c < F->nb_card; c++) {
+        int nb_true = 0;
+        for (int j = F->Card[c]; j < F->Card[c + 1]; ++j) {
+            int state = S->State[VARIABLE(F->CardLit[j])];
+            if (state != UNSET && (state & 1) == SIGN(F->CardLit[j])) {
+                nb_true++;
+            }
+        }
+        if (nb_true > F->Bound[c]) {
+            return 0;
+        }
+    }
+    // the XOR of the variables of a XOR constraint must be its parity
+    for (int c = 0; c < F->nb_xor; c++) {
+        int parity = 0;
+        for (int j = F->Xor[c]; j < F->Xor[c + 1]; ++j) {
+            int state = S->State[F->XorVar[j]];
+            if (state == UNSET) {
+                return 0;
+            }
+            parity ^= state & 1;
+        }
+        if (parity != F->Parity[c]) {
+            return 0;
+        }
+    }
     return 1;
 }
 
@@ -49,14 +75,224 @@ int check_sol(formula_t *F, sol_t *S) {
     return 1;
 }
 
+// take a new decision variable: the unset variable with highest activity if there is a variable order (VSIDS), or
+// the first active variable
+// NOTE: the variable order may contain variables that were forced, we just ignore them
+int choose_var(sol_t *S, activelist_t *A, order_t *O) {
+    if (O == NULL) {
+        return pop_active(A);
+    }
+    int var;
+    do {
+        var = pop_order(O);
+    } while (var != 0 && S->State[var] != UNSET);
+    return var;
+}
+
+// number of candidate variables evaluated by the lookahead at each decision
+#define LOOKAHEAD_VARS 16
+// number of candidate variables evaluated by the double lookahead, under a literal that propagates more assignments
+// than twice the average
+#define DOUBLE_LOOKAHEAD_VARS 4
+
+// set a literal (as if forced) at position *end of the current solution, and count it in the cardinality constraints
+// (if K isn't NULL) and in the XOR constraints (if G isn't NULL)
+// returns 0 if a cardinality constraint goes over its bound, or if a XOR constraint can't get its parity
+static int lookahead_set(formula_t *F, sol_t *S, cardlist_t *K, gauss_t *G, int lit, int *end) {
+    S->Var[(*end)++] = VARIABLE(lit);
+    S->State[VARIABLE(lit)] = 4 + SIGN(lit);
+    int ok = G == NULL || assign_gauss(G, lit);
+    return (K == NULL || assign_cards(F, S, K, lit)) && ok;
+}
+
+// set a literal after the end of the current solution, and propagate it with the watch lists (and the cardinality and
+// XOR constraints)
+// the assignments go from S->Var[*end] on, and *end is updated
+// returns 0 in case of conflict
+static int lookahead_propagate(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, cardlist_t *K, gauss_t *G,
+                               int lit, int *end) {
+    int i = *end;
+    int ok = lookahead_set(F, S, K, G, lit, end);
+    for (; ok && i < *end; i++) {
+        int x = S->Var[i];
+        if (update_watch_lists(F, S, W, A, 2 * x + 1 - (S->State[x] & 1)) == 0) {
+            ok = 0;
+            break;
+        }
+        int cl;
+        while (ok && (cl = next_unit_clause(F, S, W, A)) >= 0) {
+            ok = lookahead_set(F, S, K, G, F->Lit[F->Cl[cl]], end);
+        }
+        int card;
+        while (ok && K != NULL && (card = next_card_literal(S, K)) != EOL) {
+            ok = lookahead_set(F, S, K, G, card, end);
+        }
+        int implied;
+        while (ok && G != NULL && (implied = next_gauss_literal(S, G)) != EOL) {
+            ok = lookahead_set(F, S, K, G, implied, end);
+        }
+    }
+    if (!ok) {
+        W->nb_unit = 0;
+        if (K != NULL) {
+            K->nb_forced = 0;
+        }
+        if (G != NULL) {
+            G->nb_forced = 0;
+        }
+    }
+    return ok;
+}
+
+// remove the assignments made by the lookahead after position n of the current solution
+// NOTE: as in backtrack(), a variable may have become a watcher while it was set: it goes back to the active list
+static void lookahead_undo(sol_t *S, watchlist_t *W, activelist_t *A, cardlist_t *K, gauss_t *G, int n, int end) {
+    for (int i = n; i < end; i++) {
+        int x = S->Var[i];
+        if (!is_active(A, x) && (W->Size[2 * x] > 0 || W->Size[2 * x + 1] > 0)) {
+            push_active(x, A);
+        }
+        if (K != NULL) {
+            unassign_cards(K, 2 * x + (S->State[x] & 1));
+        }
+        if (G != NULL) {
+            unassign_gauss(G, 2 * x + (S->State[x] & 1));
+        }
+        S->State[x] = UNSET;
+        S->Var[i] = UNSET;
+    }
+}
+
+// number of assignments propagated by a literal after position n of the current solution, or EOL if it fails
+// with Cand (the candidates of the double lookahead), a literal also fails if both literals of a candidate fail after
+// it
+static int lookahead_probe(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, cardlist_t *K, gauss_t *G,
+                           int lit, int n, int *Cand, int nb_cand) {
+    int end = n;
+    int ok = lookahead_propagate(F, S, W, A, K, G, lit, &end);
+    for (int i = 0; ok && i < nb_cand; i++) {
+        int x = Cand[i];
+        if (S->State[x] != UNSET) {
+            continue;
+        }
+        int failed = 0;
+        for (int s = 0; s < 2; s++) {
+            int end2 = end;
+            failed += !lookahead_propagate(F, S, W, A, K, G, 2 * x + s, &end2);
+            lookahead_undo(S, W, A, K, G, end, end2);
+        }
+        ok = failed < 2;
+    }
+    lookahead_undo(S, W, A, K, G, n, end);
+    return ok ? end - n : EOL;
+}
+
+// number of literals of the cardinality constraints containing lit, besides lit
+static int card_weight(formula_t *F, cardlist_t *K, int lit) {
+    int weight = 0;
+    for (int k = K->Start[lit]; k < K->Start[lit + 1]; k++) {
+        weight += F->Card[K->Occ[k] + 1] - F->Card[K->Occ[k]] - 1;
+    }
+    return weight;
+}
+
+// choose the decision literal with a lookahead: among the LOOKAHEAD_VARS active variables that watch the most clauses,
+// the variable maximizing the product of the numbers of assignments propagated by its two literals, with the literal
+// that propagates less (the other one is more constrained, and more likely to fail)
+// a failed literal found along the way gives its negation, with *forced set to 1 (if it fails as well, the
+// propagation of the decision finds the conflict)
+// NOTE: there must be an active variable, and no pending unit clause
+int choose_lookahead(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, cardlist_t *K, gauss_t *G,
+                     int *forced) {
+    int Cand[LOOKAHEAD_VARS];
+    long Weight[LOOKAHEAD_VARS];
+    int nb_cand = 0;
+    int head = first_active(S, A);
+    int x = head;
+    do {
+        if (S->State[x] == UNSET) {
+            // insertion in the candidates, sorted by decreasing weight
+            // (a literal in a cardinality constraint of size n counts as n-1 watchers of its negation, as with the
+            // binary clauses of an at-most-one constraint)
+            long neg = W->Size[2 * x] + (K != NULL ? card_weight(F, K, 2 * x + 1) : 0);
+            long pos = W->Size[2 * x + 1] + (K != NULL ? card_weight(F, K, 2 * x) : 0);
+            long weight = (neg + 1) * (pos + 1);
+            int i = nb_cand < LOOKAHEAD_VARS ? nb_cand++ : LOOKAHEAD_VARS;
+            while (i > 0 && Weight[i - 1] < weight) {
+                if (i < LOOKAHEAD_VARS) {
+                    Cand[i] = Cand[i - 1];
+                    Weight[i] = Weight[i - 1];
+                }
+                i--;
+            }
+            if (i < LOOKAHEAD_VARS) {
+                Cand[i] = x;
+                Weight[i] = weight;
+            }
+        }
+        x = A->NextA[x];
+    } while (x != head);
+
+    *forced = 1;
+    int Count[2 * LOOKAHEAD_VARS];
+    long total = 0;
+    for (int i = 0; i < nb_cand; i++) {
+        for (int s = 0; s < 2; s++) {
+            Count[2 * i + s] = lookahead_probe(F, S, W, A, K, G, 2 * Cand[i] + s, S->n, NULL, 0);
+            if (Count[2 * i + s] == EOL) {
+                LOG(3, "failed literal %d\n", LIT2INT(2 * Cand[i] + s));
+                return 2 * Cand[i] + 1 - s;
+            }
+            total += Count[2 * i + s];
+        }
+    }
+    // the literals that propagate the most assignments are the most likely to fail with a double lookahead
+    int nb_double = nb_cand < DOUBLE_LOOKAHEAD_VARS ? nb_cand : DOUBLE_LOOKAHEAD_VARS;
+    for (int k = 0; k < 2 * nb_cand; k++) {
+        if (Count[k] * nb_cand > total
+            && lookahead_probe(F, S, W, A, K, G, 2 * Cand[k / 2] + k % 2, S->n, Cand, nb_double) == EOL) {
+            LOG(3, "failed literal %d (double lookahead)\n", LIT2INT(2 * Cand[k / 2] + k % 2));
+            return (2 * Cand[k / 2] + k % 2) ^ 1;
+        }
+    }
+
+    *forced = 0;
+    int best = 0;
+    long best_score = -1;
+    for (int i = 0; i < nb_cand; i++) {
+        long score = (long)Count[2 * i] * Count[2 * i + 1] + Count[2 * i] + Count[2 * i + 1];
+        if (score > best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+    return 2 * Cand[best] + (Count[2 * best + 1] < Count[2 * best]);
+}
+
 // main function: look for a solution to satisfy the global formula
-int solve(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, int BCP) {
+int solve(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, order_t *O, int BCP) {
 
     int cpt = 0;
 
     int current_var; // current variable
     int current_lit; // current literal: either 2*current_var+1 (for negative literal) or 2*n (for positive literal)
 
+    // the first top variables of the solution are forced or have been tested on both values: they keep their
+    // values until the end (unless the formula is unsatisfiable), and the formula is simplified with them
+    int top = 0;
+    int simplified_top = 0;
+    // a simplification is linear in the size of the formula: its cost is spread over as many iterations
+    int next_simplify = 0;
+    // with constraint propagation (and --pure), the pure literals are set without trying their negation
+    pure_t *P = BCP && PURE_LITERALS ? new_pure(F, S) : NULL;
+    // with constraint propagation, the cardinality constraints are handled with counters of true literals
+    cardlist_t *K = BCP && F->nb_card > 0 ? new_cardlist(F) : NULL;
+    // and the XOR constraints with Gauss-Jordan elimination (they may be inconsistent from the start)
+    gauss_t *G = BCP && F->nb_xor > 0 ? new_gauss(F) : NULL;
+    if (G != NULL && G->unsat) {
+        S->n = -1;
+    }
+
     // we don't stop until we found values for all the variables (or we've tried everything)
     while (0 <= S->n && S->n < F->nb_var) {
         cpt++;
@@ -64,48 +300,100 @@ int solve(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, int BCP) {
 
         assert(check_sanity(F, S, W, A));
 
+        while (top < S->n && S->State[S->Var[top]] >= 2) {
+            top++;
+        }
+        if (BCP && top == S->n && S->Var[S->n] == UNSET && top > simplified_top && cpt >= next_simplify) {
+            int nb_removed = simplify_top_level(F, S, W, A);
+            LOG(2, "< < <  simplification: %d variable(s) at top level, %d clause(s) removed\n", top, nb_removed);
+            simplified_top = top;
+            next_simplify = cpt + F->nb_lit;
+            if (P != NULL) {
+                // the clauses were renumbered
+                free_pure(P);
+                P = new_pure(F, S);
+            }
+            assert(check_sanity(F, S, W, A));
+        }
+
         // we need to choose a value for the n-th variable in Sol
         if (S->Var[S->n] == UNSET) { // if this variable is unset
 
             /***** CHOOSE A NEW VARIABLE *****/
-            if (A == NULL) { // if there is no active list, we simply take the next variable
+            if (A == NULL && O == NULL) { // if there is no active list, we simply take the next variable
                 current_var = S->n + 1;
-                // and it's value will be TRUE (1) or FALSE (0) depending on whether X_n or ~X_n is watched
-                S->State[current_var] = W->Head[current_var][0] == EOL || W->Head[current_var][1] != EOL;
+                // and it's value will be TRUE (1) or FALSE (0) depending on whether X_n or ~X_n watches more clauses
+                S->State[current_var] = W->Size[2 * current_var] <= W->Size[2 * current_var + 1];
 
             } else if (BCP == 0) { // if there is an active list but we don't do constraint propagation,
-                // we take the first active variable
+                // we take the first active variable (or the most active variable)
 
-                if (is_empty_active(A)) {
+                if (A != NULL && first_active(S, A) == EOL) {
                     // if there are no active variable, we've actually finished! The formula is satisfiable...
                     break;
                 }
                 // otherwise, we take the first active variable
-                current_var = A->NextA[A->last_active];
-                // and it's value will be TRUE (1) or FALSE (0) depending on whether X_n or ~X_n is watched
-                S->State[current_var] = W->Head[current_var][0] == EOL || W->Head[current_var][1] != EOL;
+                current_var = choose_var(S, A, O);
+                // and it's value will be TRUE (1) or FALSE (0) depending on whether X_n or ~X_n watches more clauses
+                S->State[current_var] = W->Size[2 * current_var] <= W->Size[2 * current_var + 1];
 
             } else { // if there is an active list and we do constraint propagation (DPLL), we look for a forced literal
-                // (a unit clause)
-
-                if (is_empty_active(A)) {
-                    // if there are no active variable, we've actually finished! The formula is satisfiable...
-                    break;
-                }
+                // (a unit clause, a literal forced by a cardinality or XOR constraint, or else a pure literal)
 
-                // otherwise, we look for a forced literal
+                // the unit clauses found by update_watch_lists
                 int cl = next_unit_clause(F, S, W, A);
-
-                if (cl < 0) {
-                    // if there is no forced literal, we take the first active variable
-                    current_var = A->NextA[A->last_active];
-                    // and it's value will be TRUE (1) or FALSE (0) depending on whether X_n or ~X_n is watched
-                    S->State[current_var] = W->Head[current_var][0] == EOL || W->Head[current_var][1] != EOL;
+                int card = cl < 0 && K != NULL ? next_card_literal(S, K) : EOL;
+                int implied = cl < 0 && card == EOL && G != NULL ? next_gauss_literal(S, G) : EOL;
+                int forced = cl >= 0 || card != EOL || implied != EOL;
+                int idle = !forced && first_active(S, A) == EOL;
+                int pure = !forced && !idle && P != NULL ? next_pure_literal(F, S, P) : EOL;
+
+                if (idle) {
+                    // if there are no active variable, the clauses are all satisfied: the variables that only appear
+                    // in the cardinality or XOR constraints (which none of them forces) are set to false
+                    current_var = K != NULL ? unset_card_var(S, K) : EOL;
+                    if (current_var == EOL && G != NULL) {
+                        current_var = unset_gauss_var(G);
+                    }
+                    if (current_var == EOL) {
+                        // we've actually finished! The formula is satisfiable...
+                        break;
+                    }
+                    S->State[current_var] = FALSE;
+                } else if (card != EOL) {
+                    // a cardinality constraint has reached its bound: its other literals are false
+                    LOG(3, "Le littéral %d est forcé par une contrainte de cardinalité\n", LIT2INT(card));
+                    current_var = VARIABLE(card);
+                    S->State[current_var] = 4 + SIGN(card);
+                } else if (implied != EOL) {
+                    // a row of the XOR constraints has a single unset variable left
+                    LOG(3, "Le littéral %d est forcé par une contrainte XOR\n", LIT2INT(implied));
+                    current_var = VARIABLE(implied);
+                    S->State[current_var] = 4 + SIGN(implied);
+                } else if (pure != EOL) {
+                    // the clauses containing the negation of a pure literal are all satisfied: if the formula is
+                    // satisfiable, it is satisfiable with the pure literal, whose negation needs not be tried
+                    LOG(3, "Le littéral %d est pur\n", LIT2INT(pure));
+                    current_var = VARIABLE(pure);
+                    S->State[current_var] = 4 + SIGN(pure);
+                } else if (cl < 0 && LOOKAHEAD) {
+                    // if there is no forced literal, the lookahead chooses the decision (or finds a failed literal)
+                    int failed;
+                    current_lit = choose_lookahead(F, S, W, A, K, G, &failed);
+                    current_var = VARIABLE(current_lit);
+                    S->State[current_var] = (failed ? 4 : 0) + SIGN(current_lit);
+                } else if (cl < 0) {
+                    // if there is no forced literal, we take the first active variable (or the most active variable)
+                    current_var = choose_var(S, A, O);
+                    // and it's value will be TRUE (1) or FALSE (0) depending on whether X_n or ~X_n watches more
+                    // clauses
+                    S->State[current_var] = W->Size[2 * current_var] <= W->Size[2 * current_var + 1];
                 } else {
                     // there was a unit clause, we use its leading (unique) literal!
                     current_lit = F->Lit[F->Cl[cl]];
                     LOG(3, "La clause %d est unitaire : elle ne contient que %d\n", cl, LIT2INT(current_lit));
                     current_var = VARIABLE(current_lit);
+                    // NOTE: forced variables stay in the active list, first_active() will remove them
                     S->State[current_var] = 4 + SIGN(current_lit);
                 }
             }
@@ -116,18 +404,21 @@ int solve(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, int BCP) {
 
         } else { // if the n-th variable in the partial solution was already set, we need to change its value
             current_var = S->Var[S->n];
+            if (P != NULL) {
+                unassign_pure(F, P, 2 * current_var + (S->State[current_var] & 1));
+            }
+            if (K != NULL) {
+                unassign_cards(K, 2 * current_var + (S->State[current_var] & 1));
+            }
+            if (G != NULL) {
+                unassign_gauss(G, 2 * current_var + (S->State[current_var] & 1));
+            }
             S->State[current_var] = 3 - S->State[current_var];
         }
 
         current_lit = 2 * current_var + (S->State[current_var] & 1);
-
-        if (A != NULL) { // we may need to update the active list
-            // If var was set as a first choice (state 0, 1), we need to remove it from the active list
-            // (in states 2, 3, the variable had already been removed)
-            int state = S->State[current_var];
-            if (state == FALSE || state == TRUE) { // == 0 || == 1
-                assert(pop_active(A) == current_var);
-            }
+        if (P != NULL) {
+            assign_pure(F, P, current_lit);
         }
 
         if (VERBOSE == 3) {
@@ -137,18 +428,47 @@ int solve(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, int BCP) {
             pprint_context(F, S, W, A);
         }
 
+        // the cardinality constraints containing current_lit get one more true literal, and the XOR constraints are
+        // reduced (a constraint that goes over its bound, or a row of the XOR constraints that can't get its parity, is
+        // a conflict, with no false clause)
+        int ok = G == NULL || assign_gauss(G, current_lit);
+        ok = (K == NULL || assign_cards(F, S, K, current_lit)) && ok;
+        if (!ok) {
+            W->conflict = EOL;
+        }
+
         // we now need to update the appropriate watch lists of current_var:
         // if it was set to TRUE, we need to update the FALSE watch_list, and vice-versa
-        if (update_watch_lists(F, S, W, A, current_lit ^ 1) > 0) {
+        if (ok && update_watch_lists(F, S, W, A, current_lit ^ 1) > 0) {
             // continue with next variable
             S->n++;
         } else { // otherwise, we need to backtrack to the last previously set
             // variable that has only been tested on one boolean value
-            S->n = backtrack(S, W, A);
+            if (O != NULL && W->conflict != EOL) {
+                // the variables of the false clause get more active
+                int cl = W->conflict;
+                for (int k = F->Cl[cl]; k < F->Cl[cl + 1]; k++) {
+                    bump_order(O, VARIABLE(F->Lit[k]));
+                }
+                decay_order(O);
+            }
+            S->n = backtrack(F, S, W, A, O, P, K, G);
+            // the unit clauses (and the literals forced by cardinality or XOR constraints) that were not used yet
+            // depended on the assignments we just removed
+            W->nb_unit = 0;
+            if (K != NULL) {
+                K->nb_forced = 0;
+            }
+            if (G != NULL) {
+                G->nb_forced = 0;
+            }
             LOG(2, "< < <  backtrack: retour à n = %d\n", S->n);
         }
     }
     assert(check_sanity(F, S, W, A));
+    free_pure(P);
+    free_cardlist(K);
+    free_gauss(G);
 
     LOG(2, "%d solutions essayées\n", cpt);
     if (S->n < 0) {
@@ -158,9 +478,73 @@ int solve(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, int BCP) {
     }
 }
 
+// simplify the formula with the values of the current solution, which must all be at top level: the satisfied
+// clauses and the false literals are removed in place (see compact_CNF), the watchers are renumbered and the variables
+// that are not watched any more leave the active list
+// NOTE: a clause that is not satisfied is watched by its first two literals, which are unset (or by its first
+// literal if it is unit), so that the remaining clauses are still watched by the same literals
+// returns the number of clauses removed
+int simplify_top_level(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A) {
+    int nb_cl = F->nb_cl;
+    int *Map = malloc((nb_cl + 1) * sizeof(int));
+    compact_CNF(F, S, Map);
+
+    // the clauses watched by an assigned literal were removed, or that literal was removed from them
+    for (int i = 0; i < S->n; i++) {
+        int x = S->Var[i];
+        W->Size[2 * x] = 0;
+        W->Size[2 * x + 1] = 0;
+    }
+    for (int lit = 2; lit < W->nb_lit; lit++) {
+        watcher_t *ws = W->Watch[lit];
+        int j = 0;
+        for (int i = 0; i < W->Size[lit]; i++) {
+            int cl = Map[ws[i].cl];
+            if (cl == EOL) {
+                continue;
+            }
+            int blocker = ws[i].blocker;
+            if (S->State[VARIABLE(blocker)] != UNSET) {
+                // the blocking literal was false: we use the other watching literal instead
+                int *c = F->Lit + F->Cl[cl];
+                blocker = c[0] == lit && F->Cl[cl + 1] - F->Cl[cl] > 1 ? c[1] : c[0];
+            }
+            ws[j].cl = cl;
+            ws[j++].blocker = blocker;
+        }
+        W->Size[lit] = j;
+    }
+    int nb_unit = 0;
+    for (int i = 0; i < W->nb_unit; i++) {
+        if (Map[W->Unit[i]] != EOL) {
+            W->Unit[nb_unit++] = Map[W->Unit[i]];
+        }
+    }
+    W->nb_unit = nb_unit;
+    free(Map);
+
+    // the active list is rebuilt in the same order
+    int *Active = malloc((F->nb_var + 1) * sizeof(int));
+    int nb_active = 0;
+    while (!is_empty_active(A)) {
+        int x = pop_active(A);
+        if (S->State[x] == UNSET && (W->Size[2 * x] > 0 || W->Size[2 * x + 1] > 0)) {
+            Active[nb_active++] = x;
+        }
+    }
+    for (int i = 0; i < nb_active; i++) {
+        push_active(Active[i], A);
+    }
+    free(Active);
+    return nb_cl - F->nb_cl;
+}
+
 // given a partial solution, backtrack to the last position where a choice was made.
 // the return value is the new index for the last variable in Sol, but this value is also updated inside S->
-int backtrack(sol_t *S, watchlist_t *W, activelist_t *A) {
+// the occurrences of the pure literals (if P isn't NULL), the counters of the cardinality constraints (if K isn't NULL)
+// and the unset variables of the XOR constraints (if G isn't NULL) are restored for the removed variables
+int backtrack(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, order_t *O, pure_t *P, cardlist_t *K,
+              gauss_t *G) {
     (void) W; // to remove unused argument warning
 
     // states 0 and 1 correspond to variables that have been tested on a single value. We can stop
@@ -172,15 +556,27 @@ int backtrack(sol_t *S, watchlist_t *W, activelist_t *A) {
         // states 2 and 3 correspond to variables that have been
         // tested on 2 values, and states 4 and 5 to forced values.
         // we need to look further: we remove the variables from the branch
+        if (P != NULL) {
+            unassign_pure(F, P, 2 * x + (S->State[x] & 1));
+        }
+        if (K != NULL) {
+            unassign_cards(K, 2 * x + (S->State[x] & 1));
+        }
+        if (G != NULL) {
+            unassign_gauss(G, 2 * x + (S->State[x] & 1));
+        }
         S->State[x] = UNSET;  // on rénitialise cette variable
         S->Var[S->n] = UNSET; // on la supprime de la solution courante
         S->n--;
 
-        if (A != NULL) {
+        if (O != NULL) {
+            insert_order(O, x);
+        }
+
+        if (A != NULL && !is_active(A, x)) {
             // we just removed a variable from the current solution, we may need to put it into the active list
-            int sign = SIGN(S->n);
-            if (W->Head[S->n][sign] == EOL) {
-                push_active(S->n, A);
+            if (W->Size[2 * x] > 0 || W->Size[2 * x + 1] > 0) {
+                push_active(x, A);
             }
         }
     }
@@ -190,73 +586,102 @@ int backtrack(sol_t *S, watchlist_t *W, activelist_t *A) {
 }
 
 // update watch lists for lit (a literal that has just become false)
-// make lit non-watched in all the clauses that where watched by it
-// if no other literal can watch the clause, it means the clause
-// becomes false and we'll need to backtrack
+// each clause is watched by its first two literals: for all the clauses watched by lit, we put lit in second
+// position and look for another non-false literal to replace it.
+// if there is none, the clause is unit (it is pushed on W->Unit) or false, and we'll need to backtrack
 // NOTE: returns 0 in case an empty clause is found
 int update_watch_lists(formula_t *F, sol_t *S, watchlist_t *W, activelist_t *A, int lit) {
-    int var = VARIABLE(lit);
-
-    int next_cl;
-    for (int cl = W->Head[var][SIGN(lit)]; cl != EOL; cl = next_cl) {
-        // BEWARE, W->Next[cl] may change during update, we need to save the value in a variable "next_cl"...
-        next_cl = W->Next[cl];
+    watcher_t *ws = W->Watch[lit];
+    int size = W->Size[lit];
+    int i, j;
+
+    for (i = j = 0; i < size; i++) {
+        int blocker = ws[i].blocker;
+        int state = S->State[VARIABLE(blocker)];
+
+        // if the blocking literal is true, the clause is satisfied: we don't even look at it
+        if (state != UNSET && (state & 1) == SIGN(blocker)) {
+            ws[j++] = ws[i];
+            continue;
+        }
 
-        // get index of a new watching literal in the clause
-        int idx = new_watching_literal(F, S, cl);
+        int cl = ws[i].cl;
+        int *c = F->Lit + F->Cl[cl];
+        if (F->Cl[cl + 1] - F->Cl[cl] > 1) {
+            // make sure the false literal is in second position
+            if (c[0] == lit) {
+                c[0] = c[1];
+                c[1] = lit;
+            }
+            // if the other watching literal is true, we keep the watcher but use it as blocking literal
+            state = S->State[VARIABLE(c[0])];
+            if (state != UNSET && (state & 1) == SIGN(c[0])) {
+                ws[j].cl = cl;
+                ws[j++].blocker = c[0];
+                continue;
+            }
 
-        if (idx == -1) {
-            LOG(3, "! ! !  La clause %d (", cl);
-            for (int k = F->Cl[cl]; k < F->Cl[cl + 1]; k++) {
-                if (k > F->Cl[cl]) {
-                    LOG(3, " ");
+            // get index of a new watching literal in the clause
+            int idx = new_watching_literal(F, S, cl);
+            if (idx != -1) {
+                // we swap the old and new watching literals, and watch the clause from the new one
+                int new_lit = F->Lit[idx];
+                int new_var = VARIABLE(new_lit);
+                c[1] = new_lit;
+                F->Lit[idx] = lit;
+                add_watcher(W, new_lit, cl, c[0]);
+
+                if (A != NULL) {
+                    // add the variable for the new watching literal in the active list (if it is UNSET and not
+                    // already active)
+                    if (S->State[new_var] == UNSET && !is_active(A, new_var)) {
+                        push_active(new_var, A);
+                    }
                 }
-                LOG(3, "%d", LIT2INT(F->Lit[k]));
+                continue;
             }
-            LOG(3, ") est fausse car tous ces littéraux sont faux.\n");
-            // we might have modified some clauses before that, and the watch list for the literal now needs to
-            // start at this clause.
-            W->Head[var][SIGN(lit)] = cl;
-            // NOTE: sanity isn't guaranteed here!
-            return 0;
         }
 
-        // otherwise, we have a new watching literal (or the clause is true, which doesn't hurt...)
-        // we swap the old and new watching literals
-        int new_lit = F->Lit[idx];
-        int new_var = VARIABLE(new_lit);
-        F->Lit[F->Cl[cl]] = new_lit;
-        F->Lit[idx] = lit;
+        // the clause stays watched by lit
+        ws[j++] = ws[i];
 
-        if (A != NULL) {
-            // add the variable for the new watching literal in the active list (if it is UNSET and not already active)
-            int state = S->State[S->n];
-            int sign = SIGN(F->Lit[S->n]);
-            if (state == UNSET && W->Head[S->n][sign]) {
-                push_active(S->n, A);
-            }
+        if (S->State[VARIABLE(c[0])] == UNSET) {
+            // the first literal is the only non false literal, the clause is unit: we push it so that
+            // next_unit_clause() finds it directly
+            W->Unit[W->nb_unit++] = cl;
+            continue;
         }
 
-        // and update the watch list
-        W->Next[cl] = W->Head[new_var][SIGN(new_lit)];
-        W->Head[new_var][SIGN(new_lit)] = cl;
+        LOG(3, "! ! !  La clause %d (", cl);
+        for (int k = F->Cl[cl]; k < F->Cl[cl + 1]; k++) {
+            if (k > F->Cl[cl]) {
+                LOG(3, " ");
+            }
+            LOG(3, "%d", LIT2INT(F->Lit[k]));
+        }
+        LOG(3, ") est fausse car tous ces littéraux sont faux.\n");
+        W->conflict = cl;
+        // we keep the remaining watchers
+        while (++i < size) {
+            ws[j++] = ws[i];
+        }
+        W->Size[lit] = j;
+        return 0;
     }
-
-    // lit isn't watching any clause anymore
-    W->Head[var][SIGN(lit)] = EOL;
+    W->Size[lit] = j;
 
     return 1;
 }
 
-// look for a new literal to serve as the watcher for clause ``cl``
+// look for a new literal to serve as the second watcher for clause ``cl``
 // returns the index (in Lit array) of this literal on success
-// returns -1 if lit was the last non-false literal in the clause
+// returns -1 if there is no non-false literal after the first two ones
 int new_watching_literal(formula_t *F, sol_t *S, int cl) {
-    for (int i = F->Cl[cl] + 1; i < F->Cl[cl + 1]; ++i) {
+    for (int i = F->Cl[cl] + 2; i < F->Cl[cl + 1]; ++i) {
         int state = S->State[VARIABLE(F->Lit[i])];
         int sign = SIGN(F->Lit[i]);
-        if ((sign && (state == TRUE || state == TRUE_WAS_FALSE)) ||
-            (!sign && (state == FALSE || state == FALSE_WAS_TRUE)) || state == UNSET) {
+        // forced values count as well: only the parity of the state gives the value
+        if (state == UNSET || (state & 1) == sign) {
             return i;
         }
     }
@@ -264,12 +689,15 @@ int new_watching_literal(formula_t *F, sol_t *S, int cl) {
 }
 
 // is the given clause a unit clause?
-// NOTE: we assume the leading literal is unset
+// NOTE: we assume the leading literal is unset, the clause is unit when all the other literals are false
 int is_unit(formula_t *F, sol_t *S, int cl) {
     assert(S->State[VARIABLE(F->Lit[F->Cl[cl]])] == UNSET);
-    (void) F; // to remove unused argument warning
-    (void) S; // to remove unused argument warning
-    (void) cl; // to remove unused argument warning
+    for (int i = F->Cl[cl] + 1; i < F->Cl[cl + 1]; ++i) {
+        int state = S->State[VARIABLE(F->Lit[i])];
+        if (state == UNSET || (state & 1) == SIGN(F->Lit[i])) {
+            return 0;
+        }
+    }
     return 1;
 }
 
@@ -0,0 +1,165 @@
+#include "sat.h"
+
+// Library interface.
+//
+// A solver keeps its CDCL engine from one call to the next: the clauses added so far, the learned
+// clauses, the watch lists and the activities of the variables are kept, so that a series of
+// related questions about the same formula is answered without starting again from scratch.
+// Learned clauses remain valid when clauses are added, and they never depend on the assumptions,
+// which are only decisions.
+//
+// Literals are given as in DIMACS files (x or -x, for 1 <= x <= nb_var), and the variables are
+// those of the initial formula.
+
+// create a solver for a formula (F is copied, and may be freed afterwards)
+solver_t* new_solver(formula_t* F)
+{
+    solver_t* L = malloc(sizeof(solver_t));
+    int n = F->nb_var;
+    L->F = copy_formula(F);
+    L->S = new_sol(n);
+    L->O = new_order(n);
+    L->C = new_cdcl(L->F, L->S, L->O);
+    L->Model = malloc((n + 1) * sizeof(char));
+    for (int x = 0; x <= n; x++) {
+        L->Model[x] = UNSET;
+    }
+    L->Failed = malloc(sizeof(int));
+    L->nb_failed = 0;
+    L->Decisions = malloc((n + 1) * sizeof(int));
+    L->nb_decisions = 0;
+    return L;
+}
+
+// free a solver
+void free_solver(solver_t* L)
+{
+    if (L == NULL)
+        return;
+    free_cdcl(L->C);
+    free_order(L->O);
+    free_sol(L->S);
+    free_formula(L->F);
+    free(L->Model);
+    free(L->Failed);
+    free(L->Decisions);
+    free(L);
+}
+
+// convert DIMACS literals into literals of the engine
+// returns 0 if a variable doesn't exist
+static int convert_lits(solver_t* L, int* lits, int size, int* Lits)
+{
+    for (int i = 0; i < size; i++) {
+        if (lits[i] == 0 || abs(lits[i]) > L->F->nb_var) {
+            fprintf(stderr, "*** invalid literal %d (the formula has %d variable(s))\n", lits[i],
+                L->F->nb_var);
+            return 0;
+        }
+        Lits[i] = INT2LIT(lits[i]);
+    }
+    return 1;
+}
+
+// add a clause to the formula
+// returns 0 if the formula is now known to be unsatisfiable, and EOL if the clause is invalid
+int solver_add_clause(solver_t* L, int* lits, int size)
+{
+    cdcl_t* C = L->C;
+    int Lits[size + 1];
+    if (!convert_lits(L, lits, size, Lits)) {
+        return EOL;
+    }
+    // remove repeated literals, and ignore tautologies
+    int n = 0;
+    for (int i = 0; i < size; i++) {
+        int k;
+        for (k = 0; k < n; k++) {
+            if (VARIABLE(Lits[k]) == VARIABLE(Lits[i])) {
+                break;
+            }
+        }
+        if (k == n) {
+            Lits[n++] = Lits[i];
+        } else if (Lits[k] != Lits[i]) {
+            return !C->unsat;
+        }
+    }
+    // clauses are added at level 0 (the engine stays on its last assignment after a search)
+    while (C->level > 0) {
+        pop_decision(C);
+    }
+    return add_formula_clause(C, Lits, n);
+}
+
+// look for a model of the formula where all the assumptions are true
+// returns 1 (the model is given by solver_value()) or 0 (the failed assumptions are given by
+// solver_failed(): the formula is unsatisfiable when all of them are true), or EOL if an
+// assumption is invalid
+int solver_solve(solver_t* L, int* assumptions, int n)
+{
+    cdcl_t* C = L->C;
+    L->nb_failed = 0;
+    L->nb_decisions = 0;
+    for (int x = 0; x <= L->F->nb_var; x++) {
+        L->Model[x] = UNSET;
+    }
+    int Assumptions[n + 1];
+    if (!convert_lits(L, assumptions, n, Assumptions)) {
+        return EOL;
+    }
+    set_assumptions(C, Assumptions, n);
+
+    int sat = run_cdcl(C);
+    LOG(1, "%s, %ld conflict(s) so far, %d learned clause(s)\n",
+        sat ? "satisfiable" : "unsatisfiable", C->nb_conflicts, C->nb_learnts);
+    if (sat) {
+        for (int x = 1; x <= L->F->nb_var; x++) {
+            L->Model[x] = L->S->State[x] & 1;
+        }
+        // the decisions are the first literals of the levels (after the assumptions)
+        L->nb_decisions = 0;
+        for (int l = C->nb_assumptions; l < C->level; l++) {
+            int x = L->S->Var[C->TrailLim[l]];
+            if (C->TrailLim[l] < L->S->n && C->Level[x] == l + 1 && C->Reason[x] == EOL) {
+                L->Decisions[L->nb_decisions++] = (L->S->State[x] & 1) ? x : -x;
+            }
+        }
+    } else {
+        L->Failed = realloc(L->Failed, (C->nb_failed + 1) * sizeof(int));
+        for (int i = 0; i < C->nb_failed; i++) {
+            L->Failed[i] = LIT2INT(C->Failed[i]);
+        }
+        L->nb_failed = C->nb_failed;
+    }
+    return sat;
+}
+
+// value (TRUE or FALSE) of a variable in the last model, or UNSET if there is none
+int solver_value(solver_t* L, int var)
+{
+    if (var < 1 || var > L->F->nb_var) {
+        return UNSET;
+    }
+    return L->Model[var];
+}
+
+// decisions of the last model, stored in *lits: the model is the only one where they are all true
+// (the other values follow from them by unit propagation), so that the negation of the decisions
+// is a short clause blocking the model
+// returns their number
+int solver_decisions(solver_t* L, int** lits)
+{
+    *lits = L->Decisions;
+    return L->nb_decisions;
+}
+
+// failed assumptions of the last search (that was unsatisfiable), stored in *lits
+// returns their number (0 when the formula is unsatisfiable without any assumption)
+int solver_failed(solver_t* L, int** lits)
+{
+    *lits = L->Failed;
+    return L->nb_failed;
+}
+
+// vim600: set foldmethod=syntax textwidth=100:
@@ -9,9 +9,96 @@ void help_test()
            "pCNF [FICHIER]          show pretty CNF formula\n"
            "watchlists [FICHIER]    show watchlists for the CNF formula\n"
            "active [FICHIER]        show active lists for the CNF formula\n"
+           "count [N]               compare --count with --count -P on N random formulas\n"
+           "cubes [N]               compare -Q with -C on N random 3-SAT formulas (default: 200)\n"
+           "backbone [FICHIER]      show the variables that have the same value in all the models\n"
+           "                        (incremental solving with assumptions)\n"
            "\n");
 }
 
+// random formula with nb_var variables and nb_cl clauses of min_size to max_size distinct variables
+static formula_t* random_formula(int nb_var, int nb_cl, int min_size, int max_size)
+{
+    FILE* f = tmpfile();
+    fprintf(f, "p cnf %d %d\n", nb_var, nb_cl);
+    for (int cl = 0; cl < nb_cl; cl++) {
+        int size = min_size + rand() % (max_size - min_size + 1);
+        int Var[size];
+        for (int i = 0; i < size; i++) {
+            int j;
+            do {
+                Var[i] = 1 + rand() % nb_var;
+                for (j = 0; j < i && Var[j] != Var[i]; j++) {
+                }
+            } while (j < i);
+            fprintf(f, "%d ", rand() % 2 ? Var[i] : -Var[i]);
+        }
+        fprintf(f, "0\n");
+    }
+    rewind(f);
+    formula_t* F = parse_formula(f);
+    fclose(f);
+    return F;
+}
+
+// count the models of small random formulas with the exhaustive search, with and without the
+// preprocessing (the variables it sets must only be counted once)
+static int test_count(int nb)
+{
+    int nb_bad = 0;
+    srand(1);
+    for (int i = 0; i < nb; i++) {
+        formula_t* F = random_formula(3 + rand() % 12, 1 + rand() % 8, 1, 3);
+        sol_t* S = new_sol(F->nb_var);
+        unsigned long long nb_models;
+        solve_brute(F, S, &nb_models);
+        free_sol(S);
+        S = new_sol(F->nb_var);
+        unsigned long long nb_models2 = 0;
+        if (preprocess(F, S) != -1) {
+            solve_brute(F, S, &nb_models2);
+        }
+        if (nb_models != nb_models2) {
+            printf("formula %d: %llu model(s) with --count, %llu with --count -P\n", i, nb_models,
+                nb_models2);
+            nb_bad++;
+        }
+        free_sol(S);
+        free_formula(F);
+    }
+    printf("%d formula(s) out of %d with different counts\n", nb_bad, nb);
+    return nb_bad > 0;
+}
+
+// solve random 3-SAT formulas with 10 variables, around the threshold, with the cubes (and 2
+// threads) and with CDCL, and compare the results
+static int test_cubes(int nb)
+{
+    int nb_bad = 0;
+    NB_THREADS = 2;
+    srand(1);
+    for (int i = 0; i < nb; i++) {
+        formula_t* F = random_formula(10, 38 + rand() % 10, 3, 3);
+        formula_t* G = copy_formula(F);
+        sol_t* S = new_sol(F->nb_var);
+        int sat = solve_cubes(G, S);
+        free_formula(G);
+        G = copy_formula(F);
+        sol_t* S2 = new_sol(F->nb_var);
+        int sat2 = solve_cdcl(G, S2, NULL);
+        free_formula(G);
+        if (sat != sat2 || (sat && !is_solution(F, S))) {
+            printf("formula %d: %d with -Q, %d with -C\n", i, sat, sat2);
+            nb_bad++;
+        }
+        free_sol(S);
+        free_sol(S2);
+        free_formula(F);
+    }
+    printf("%d formula(s) out of %d with different results\n", nb_bad, nb);
+    return nb_bad > 0;
+}
+
 int test(char* cmd, int argc, char** argv)
 {
 
@@ -19,6 +106,12 @@ int test(char* cmd, int argc, char** argv)
         help_test();
         return 0;
     }
+    if (0 == strcmp(cmd, "count")) {
+        return test_count(argc > 0 ? atoi(argv[0]) : 1000);
+    }
+    if (0 == strcmp(cmd, "cubes")) {
+        return test_cubes(argc > 0 ? atoi(argv[0]) : 200);
+    }
 
     FILE* f_in;
     if (argc > 0) {
@@ -55,6 +148,33 @@ int test(char* cmd, int argc, char** argv)
         watchlist_t* W = init_watchlists(F);
         activelist_t* A = init_activelist(F, W);
         pprint_activelist(A);
+    } else if (0 == strcmp(cmd, "backbone")) {
+        printf("TEST => show backbone\n");
+        solver_t* L = new_solver(F);
+        if (solver_solve(L, NULL, 0) != 1) {
+            printf("UNSATISFIABLE\n");
+        } else {
+            // a variable is in the backbone iff the formula is unsatisfiable when it takes the
+            // other value than in a model
+            char* Model = malloc((F->nb_var + 1) * sizeof(char));
+            for (int x = 1; x <= F->nb_var; x++) {
+                Model[x] = solver_value(L, x);
+            }
+            int nb = 0;
+            for (int x = 1; x <= F->nb_var; x++) {
+                int lit = Model[x] ? -x : x;
+                if (solver_solve(L, &lit, 1) == 0) {
+                    printf("%s%d ", Model[x] ? "" : "-", x);
+                    nb++;
+                    // learning it makes the next calls easier
+                    lit = -lit;
+                    solver_add_clause(L, &lit, 1);
+                }
+            }
+            printf("\n%d variable(s) in the backbone\n", nb);
+            free(Model);
+        }
+        free_solver(L);
     } else {
         printf("unknown test: '%s'\n", cmd);
     }
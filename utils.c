@@ -1,5 +1,15 @@
 #include "sat.h"
 
+// global variables (settings), defined here so that the library doesn't depend on main.c
+int VERBOSE = 0;
+int BUF_SIZE = 4096;
+int RESTART = RESTART_LUBY;
+int LUBY_UNIT = 100;
+int PHASE_SAVING = 1;
+int PURE_LITERALS = 0;
+int LOOKAHEAD = 0;
+int NB_THREADS = 1;
+
 /////////////////
 // misc functions
 
@@ -92,9 +102,23 @@ formula_t* parse_formula(FILE* f_in)
     int size_Cl = 1;        // actual size of the Cl array
     int size_Lit = 1;       // actual size of Lit array
     int size_VarName = 1;   // actual size of VarName array
+    int nb_card = 0;        // number of cardinality constraints read from file
+    int nb_card_lit = 0;    // number of literals of the cardinality constraints
+    int size_Card = 1;      // actual size of the Card and Bound arrays
+    int size_CardLit = 1;   // actual size of the CardLit array
+    int nb_xor = 0;         // number of XOR constraints read from file
+    int nb_xor_var = 0;     // number of variables of the XOR constraints
+    int size_Xor = 1;       // actual size of the Xor and Parity arrays
+    int size_XorVar = 1;    // actual size of the XorVar array
 
     int* Cl = malloc(size_Cl * sizeof(int));
     int* Lit = malloc(size_Lit * sizeof(int));
+    int* Card = malloc(size_Card * sizeof(int));
+    int* Bound = malloc(size_Card * sizeof(int));
+    int* CardLit = malloc(size_CardLit * sizeof(int));
+    int* Xor = malloc(size_Xor * sizeof(int));
+    int* Parity = malloc(size_Xor * sizeof(int));
+    int* XorVar = malloc(size_XorVar * sizeof(int));
     char** VarName = malloc(size_VarName * sizeof(char*));
     VarName[0] = NULL;
 
@@ -142,6 +166,9 @@ formula_t* parse_formula(FILE* f_in)
                            // directly the appropriate
             continue;      // sizes for VAR and CL
         }
+        // a line starting with 'x' is a XOR constraint
+        int is_xor = *buf == 'x';
+        buf += is_xor;
 
         if (size_Cl <= current_clause) { // realloc CL array if necessary
             size_Cl *= 2;
@@ -151,6 +178,54 @@ formula_t* parse_formula(FILE* f_in)
         Cl[current_clause] = current_lit;
         while (1) { // parse all literals from current line buffer
             int l = strtol(buf, &buf, 10);
+            trim_blanks(&buf);
+            if (l == 0 && (*buf == '<' || *buf == '>') && buf[1] == '=') {
+                // the literals are those of a cardinality constraint "<= k" or ">= k"
+                int at_least = *buf == '>';
+                int bound = strtol(buf + 2, &buf, 10);
+                int start = Cl[current_clause];
+                int size = current_lit - start;
+                if (size_Card <= nb_card + 1) {
+                    size_Card *= 2;
+                    Card = realloc(Card, size_Card * sizeof(int));
+                    Bound = realloc(Bound, size_Card * sizeof(int));
+                }
+                while (size_CardLit <= nb_card_lit + size) {
+                    size_CardLit *= 2;
+                    CardLit = realloc(CardLit, size_CardLit * sizeof(int));
+                }
+                // at least k literals are true iff at most n-k of their negations are true
+                Card[nb_card] = nb_card_lit;
+                Bound[nb_card++] = at_least ? size - bound : bound;
+                for (int i = start; i < current_lit; i++) {
+                    CardLit[nb_card_lit++] = at_least ? Lit[i] ^ 1 : Lit[i];
+                }
+                current_lit = start;
+                break;
+            }
+            if (l == 0 && is_xor) {
+                // the literals are those of a XOR constraint, a negative literal flips its parity
+                int start = Cl[current_clause];
+                int size = current_lit - start;
+                if (size_Xor <= nb_xor + 1) {
+                    size_Xor *= 2;
+                    Xor = realloc(Xor, size_Xor * sizeof(int));
+                    Parity = realloc(Parity, size_Xor * sizeof(int));
+                }
+                while (size_XorVar <= nb_xor_var + size) {
+                    size_XorVar *= 2;
+                    XorVar = realloc(XorVar, size_XorVar * sizeof(int));
+                }
+                Xor[nb_xor] = nb_xor_var;
+                Parity[nb_xor] = 1;
+                for (int i = start; i < current_lit; i++) {
+                    XorVar[nb_xor_var++] = VARIABLE(Lit[i]);
+                    Parity[nb_xor] ^= 1 - SIGN(Lit[i]);
+                }
+                nb_xor++;
+                current_lit = start;
+                break;
+            }
             if (l == 0) {
                 current_clause++;
                 break;
@@ -184,6 +259,9 @@ formula_t* parse_formula(FILE* f_in)
         free(VarName[i]);
     }
     VarName = realloc(VarName, (nb_var + 1) * sizeof(char*));
+    for (int i = size_VarName; i <= nb_var; i++) {
+        VarName[i] = NULL;
+    }
 
     formula_t* F = malloc(sizeof(formula_t));
     F->nb_var = nb_var;
@@ -191,10 +269,58 @@ formula_t* parse_formula(FILE* f_in)
     F->nb_lit = current_lit;
     F->Lit = Lit;
     F->Cl = Cl;
+    F->nb_card = nb_card;
+    F->CardLit = CardLit;
+    F->Card = Card;
+    F->Card[nb_card] = nb_card_lit;
+    F->Bound = Bound;
+    F->nb_xor = nb_xor;
+    F->XorVar = XorVar;
+    F->Xor = Xor;
+    F->Xor[nb_xor] = nb_xor_var;
+    F->Parity = Parity;
     F->VarName = VarName;
+    normalize_cards(F);
+    normalize_xors(F);
     return F;
 }
 
+// make a copy of a formula
+formula_t* copy_formula(formula_t* F)
+{
+    formula_t* G = malloc(sizeof(formula_t));
+    G->nb_var = F->nb_var;
+    G->nb_cl = F->nb_cl;
+    G->nb_lit = F->nb_lit;
+    G->Lit = malloc((F->nb_lit + 1) * sizeof(int));
+    G->Cl = malloc((F->nb_cl + 1) * sizeof(int));
+    G->VarName = malloc((F->nb_var + 1) * sizeof(char*));
+    memcpy(G->Lit, F->Lit, F->nb_lit * sizeof(int));
+    memcpy(G->Cl, F->Cl, (F->nb_cl + 1) * sizeof(int));
+    G->nb_card = F->nb_card;
+    G->CardLit = malloc((F->Card[F->nb_card] + 1) * sizeof(int));
+    G->Card = malloc((F->nb_card + 1) * sizeof(int));
+    G->Bound = malloc((F->nb_card + 1) * sizeof(int));
+    memcpy(G->CardLit, F->CardLit, F->Card[F->nb_card] * sizeof(int));
+    memcpy(G->Card, F->Card, (F->nb_card + 1) * sizeof(int));
+    memcpy(G->Bound, F->Bound, F->nb_card * sizeof(int));
+    G->nb_xor = F->nb_xor;
+    G->XorVar = malloc((F->Xor[F->nb_xor] + 1) * sizeof(int));
+    G->Xor = malloc((F->nb_xor + 1) * sizeof(int));
+    G->Parity = malloc((F->nb_xor + 1) * sizeof(int));
+    memcpy(G->XorVar, F->XorVar, F->Xor[F->nb_xor] * sizeof(int));
+    memcpy(G->Xor, F->Xor, (F->nb_xor + 1) * sizeof(int));
+    memcpy(G->Parity, F->Parity, F->nb_xor * sizeof(int));
+    for (int i = 0; i <= F->nb_var; i++) {
+        G->VarName[i] = NULL;
+        if (F->VarName[i] != NULL) {
+            G->VarName[i] = malloc(NAME_SIZE * sizeof(char));
+            memcpy(G->VarName[i], F->VarName[i], NAME_SIZE);
+        }
+    }
+    return G;
+}
+
 // free a formula
 void free_formula(formula_t* F)
 {
@@ -202,6 +328,12 @@ void free_formula(formula_t* F)
         return;
     free(F->Lit);
     free(F->Cl);
+    free(F->CardLit);
+    free(F->Card);
+    free(F->Bound);
+    free(F->XorVar);
+    free(F->Xor);
+    free(F->Parity);
     for (int i = 0; i <= F->nb_var; i++) {
         free(F->VarName[i]);
     }
@@ -212,18 +344,24 @@ void free_formula(formula_t* F)
 ///////////////////////////
 // dealing with watch lists
 
-// initializes the watch lists
-watchlist_t* init_watchlists(formula_t* F)
+// create empty watch lists (with a Unit stack for nb_cl clauses)
+watchlist_t* new_watchlist(int nb_var, int nb_cl)
 {
     watchlist_t* W = malloc(sizeof(watchlist_t));
-    W->Next = malloc(F->nb_cl * sizeof(int));
-    W->Head = malloc((F->nb_var + 1) * sizeof(int[2]));
+    W->nb_lit = 2 * nb_var + 2;
+    W->Watch = calloc(W->nb_lit, sizeof(watcher_t*));
+    W->Size = calloc(W->nb_lit, sizeof(int));
+    W->Cap = calloc(W->nb_lit, sizeof(int));
+    W->Unit = malloc((nb_cl + 1) * sizeof(int));
+    W->nb_unit = 0;
+    W->conflict = EOL;
+    return W;
+}
 
-    // initialize watch lists heads
-    for (int i = 1; i <= F->nb_var; i++) {
-        W->Head[i][0] = EOL;
-        W->Head[i][1] = EOL;
-    }
+// initializes the watch lists
+watchlist_t* init_watchlists(formula_t* F)
+{
+    watchlist_t* W = new_watchlist(F->nb_var, F->nb_cl);
 
     // initialize watch lists
     for (int i = 0; i < F->nb_cl; i++) {
@@ -232,12 +370,14 @@ watchlist_t* init_watchlists(formula_t* F)
             printf("UNSATISFIABLE\n");
             exit(2);
         }
-        int l = F->Lit[F->Cl[i]];
-        int x = VARIABLE(l);
-        int s = SIGN(l);
-        int tmp = W->Head[x][s];
-        W->Head[x][s] = i;
-        W->Next[i] = tmp;
+        int* c = F->Lit + F->Cl[i];
+        if (F->Cl[i + 1] - F->Cl[i] == 1) { // the clause is already unit
+            add_watcher(W, c[0], i, c[0]);
+            W->Unit[W->nb_unit++] = i;
+        } else {
+            add_watcher(W, c[0], i, c[1]);
+            add_watcher(W, c[1], i, c[0]);
+        }
     }
     return W;
 }
@@ -247,11 +387,185 @@ void free_watchlist(watchlist_t* W)
 {
     if (W == NULL)
         return;
-    free(W->Head);
-    free(W->Next);
+    for (int l = 0; l < W->nb_lit; l++) {
+        free(W->Watch[l]);
+    }
+    free(W->Watch);
+    free(W->Size);
+    free(W->Cap);
+    free(W->Unit);
     free(W);
 }
 
+// add a clause at the end of the watch list of a literal
+void add_watcher(watchlist_t* W, int lit, int cl, int blocker)
+{
+    if (W->Size[lit] == W->Cap[lit]) {
+        W->Cap[lit] = W->Cap[lit] == 0 ? 4 : 2 * W->Cap[lit];
+        W->Watch[lit] = realloc(W->Watch[lit], W->Cap[lit] * sizeof(watcher_t));
+    }
+    W->Watch[lit][W->Size[lit]].cl = cl;
+    W->Watch[lit][W->Size[lit]].blocker = blocker;
+    W->Size[lit]++;
+}
+
+//////////////////////////////////
+// dealing with occurrence lists
+
+// compute the occurrence lists of a formula
+occurrences_t* new_occurrences(formula_t* F)
+{
+    occurrences_t* O = malloc(sizeof(occurrences_t));
+    O->nb_lit = 2 * F->nb_var + 2;
+    O->Start = calloc(O->nb_lit + 1, sizeof(int));
+    O->Occ = malloc((F->nb_lit + 1) * sizeof(int));
+    // count the occurrences of each literal, and compute where the list of each literal starts
+    for (int i = 0; i < F->nb_lit; i++) {
+        O->Start[F->Lit[i] + 1]++;
+    }
+    for (int l = 0; l < O->nb_lit; l++) {
+        O->Start[l + 1] += O->Start[l];
+    }
+    // fill the lists, Start[lit] is used as the next free position of the list of lit...
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+            O->Occ[O->Start[F->Lit[i]]++] = cl;
+        }
+    }
+    // ... so that it ends up at the start of the next list
+    for (int l = O->nb_lit; l > 0; l--) {
+        O->Start[l] = O->Start[l - 1];
+    }
+    O->Start[0] = 0;
+    return O;
+}
+
+// free occurrence lists
+void free_occurrences(occurrences_t* O)
+{
+    if (O == NULL)
+        return;
+    free(O->Start);
+    free(O->Occ);
+    free(O);
+}
+
+/////////////////////////////
+// dealing with pure literals
+
+// push a literal that may be pure on the stack of candidates
+static void push_pure(pure_t* P, int lit)
+{
+    if (!P->InPure[lit]) {
+        P->InPure[lit] = 1;
+        P->Pure[P->nb_pure++] = lit;
+    }
+}
+
+// count the occurrences of the literals in the clauses that are not satisfied by S
+pure_t* new_pure(formula_t* F, sol_t* S)
+{
+    pure_t* P = malloc(sizeof(pure_t));
+    int nb_lit = 2 * F->nb_var + 2;
+    P->O = new_occurrences(F);
+    P->NbTrue = calloc(F->nb_cl + 1, sizeof(int));
+    P->Count = calloc(nb_lit, sizeof(int));
+    P->Pure = malloc(nb_lit * sizeof(int));
+    P->nb_pure = 0;
+    P->InPure = calloc(nb_lit, sizeof(char));
+    for (int cl = 0; cl < F->nb_cl; cl++) {
+        for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+            int x = VARIABLE(F->Lit[i]);
+            if (S->State[x] != UNSET && (S->State[x] & 1) == SIGN(F->Lit[i])) {
+                P->NbTrue[cl]++;
+            }
+        }
+        if (P->NbTrue[cl] == 0) {
+            for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+                P->Count[F->Lit[i]]++;
+            }
+        }
+    }
+    // a literal of a cardinality constraint is never pure (but its negation may be)
+    for (int i = 0; i < F->Card[F->nb_card]; i++) {
+        P->Count[F->CardLit[i] ^ 1]++;
+    }
+    // nor is a literal of a XOR constraint
+    for (int i = 0; i < F->Xor[F->nb_xor]; i++) {
+        P->Count[2 * F->XorVar[i]]++;
+        P->Count[2 * F->XorVar[i] + 1]++;
+    }
+    for (int lit = nb_lit - 1; lit >= 2; lit--) {
+        if (P->Count[lit] > 0 && P->Count[lit ^ 1] == 0) {
+            push_pure(P, lit);
+        }
+    }
+    return P;
+}
+
+// free pure literals
+void free_pure(pure_t* P)
+{
+    if (P == NULL)
+        return;
+    free_occurrences(P->O);
+    free(P->NbTrue);
+    free(P->Count);
+    free(P->Pure);
+    free(P->InPure);
+    free(P);
+}
+
+// a literal became true: the clauses that contain it don't count anymore, and the negations of the
+// literals that don't occur anymore may be pure
+void assign_pure(formula_t* F, pure_t* P, int lit)
+{
+    occurrences_t* O = P->O;
+    for (int k = O->Start[lit]; k < O->Start[lit + 1]; k++) {
+        int cl = O->Occ[k];
+        if (P->NbTrue[cl]++ == 0) {
+            for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+                if (--P->Count[F->Lit[i]] == 0) {
+                    push_pure(P, F->Lit[i] ^ 1);
+                }
+            }
+        }
+    }
+}
+
+// a literal isn't true anymore: the clauses that contain it may count again
+// the variable is unset: one of its literals may be pure
+void unassign_pure(formula_t* F, pure_t* P, int lit)
+{
+    occurrences_t* O = P->O;
+    for (int k = O->Start[lit]; k < O->Start[lit + 1]; k++) {
+        int cl = O->Occ[k];
+        if (--P->NbTrue[cl] == 0) {
+            for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+                P->Count[F->Lit[i]]++;
+            }
+        }
+    }
+    push_pure(P, lit);
+    push_pure(P, lit ^ 1);
+}
+
+// return an unset literal that occurs in the clauses that are not satisfied while its negation
+// doesn't, or EOL if there is none
+// NOTE: the stack contains literals that may have been pure at some point, they are checked here
+int next_pure_literal(formula_t* F, sol_t* S, pure_t* P)
+{
+    (void)F;
+    while (P->nb_pure > 0) {
+        int lit = P->Pure[--P->nb_pure];
+        P->InPure[lit] = 0;
+        if (S->State[VARIABLE(lit)] == UNSET && P->Count[lit] > 0 && P->Count[lit ^ 1] == 0) {
+            return lit;
+        }
+    }
+    return EOL;
+}
+
 ////////////////////////////
 // dealing with active lists
 
@@ -260,18 +574,17 @@ activelist_t* init_activelist(formula_t* F, watchlist_t* W)
 {
     activelist_t* A = malloc(sizeof(activelist_t));
     A->NextA = malloc((1 + F->nb_var) * sizeof(int));
-    /* not necessary
+    // variables that are not in the active list have 0 as next element
     for (int i = 0; i <= F->nb_var; i++) {
-        A->NextA[i] = UNSET;
+        A->NextA[i] = 0;
     }
-    */
 
     // initialize active list
     A->last_active = EOL;
     int prev = 1;
     for (int k = F->nb_var; k > 0; k--) {
         // TODO valgrind error
-        if (W->Head[k][0] != EOL || W->Head[k][1] != EOL) {
+        if (W->Size[2 * k] > 0 || W->Size[2 * k + 1] > 0) {
             if (A->last_active == EOL) {
                 A->last_active = k;
             }
@@ -295,21 +608,7 @@ void free_activelist(activelist_t* A)
 }
 
 // check if a variable is in the active list
-// (should only be used for debug purposes)
-int is_active(activelist_t* A, int var)
-{
-    if (A->last_active == EOL) {
-        return 0;
-    }
-    int prev, v;
-    for (prev = 0, v = A->NextA[A->last_active]; prev != A->last_active;
-         prev = v, v = A->NextA[v]) {
-        if (v == var) {
-            return 1;
-        }
-    }
-    return 0;
-}
+int is_active(activelist_t* A, int var) { return A->NextA[var] != 0; }
 
 // check if the active list is empty
 int is_empty_active(activelist_t* A) { return A->last_active == EOL; }
@@ -339,47 +638,222 @@ int pop_active(activelist_t* A)
     } else {
         A->NextA[A->last_active] = A->NextA[A->NextA[A->last_active]];
     }
+    A->NextA[head] = 0;
     return head;
 }
 
+// return the first unset variable of the active list, or EOL if there is none
+// NOTE: variables that were forced are not removed from the active list when they are set, we
+// remove them lazily here
+int first_active(sol_t* S, activelist_t* A)
+{
+    while (A->last_active != EOL) {
+        int head = A->NextA[A->last_active];
+        if (S->State[head] == UNSET) {
+            return head;
+        }
+        pop_active(A);
+    }
+    return EOL;
+}
+
 // return the index of a unit clause, if possible
 // otherwise, -1 is returned
+// NOTE: unit clauses are pushed on W->Unit by update_watch_lists when they are discovered, so we
+// only need to look at the top of this stack
 int next_unit_clause(formula_t* F, sol_t* S, watchlist_t* W, activelist_t* A)
 {
-    assert(!is_empty_active(A));
-    int prev = 0;
-    int v = A->NextA[A->last_active];
+    (void)A;
+    while (W->nb_unit > 0) {
+        int cl = W->Unit[--W->nb_unit];
+        // the leading literal may have been set since the clause was pushed, by another unit
+        // clause: the clause is then satisfied (if it was false, a conflict would have been found
+        // when updating the watch lists)
+        if (S->State[VARIABLE(F->Lit[F->Cl[cl]])] == UNSET) {
+            return cl;
+        }
+    }
+    return -1;
+}
 
-    while (1) {
-        // is there a unit clause watched by v? We look at all the clauses
-        // watched by v
-        for (int cl = W->Head[v][0]; cl != EOL; cl = W->Next[cl]) {
-            if (is_unit(F, S, cl)) {
-                // success, we found a unit clause watched by v
-                // we update the active list to start searching from here
-                A->last_active = prev != 0 ? prev : A->last_active;
-                return cl;
-            }
+///////////////////////////////
+// dealing with variable orders
+
+// initializes a variable order containing all the variables, with activity 0
+order_t* new_order(int nb_var)
+{
+    order_t* O = malloc(sizeof(order_t));
+    O->nb_var = nb_var;
+    O->Activity = malloc((nb_var + 1) * sizeof(double));
+    O->Heap = malloc((nb_var + 1) * sizeof(int));
+    O->Pos = malloc((nb_var + 1) * sizeof(int));
+    O->inc = 1.0;
+    O->decay = 0.95;
+    O->size = 0;
+    O->Pos[0] = EOL;
+    O->Activity[0] = 0.0;
+    for (int x = 1; x <= nb_var; x++) {
+        O->Activity[x] = 0.0;
+        O->Pos[x] = EOL;
+        insert_order(O, x);
+    }
+    return O;
+}
+
+// free a variable order
+void free_order(order_t* O)
+{
+    if (O == NULL)
+        return;
+    free(O->Activity);
+    free(O->Heap);
+    free(O->Pos);
+    free(O);
+}
+
+// move the variable at position i up in the heap, until its parent has higher activity
+static void percolate_up(order_t* O, int i)
+{
+    int x = O->Heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (O->Activity[O->Heap[parent]] >= O->Activity[x]) {
+            break;
         }
+        O->Heap[i] = O->Heap[parent];
+        O->Pos[O->Heap[i]] = i;
+        i = parent;
+    }
+    O->Heap[i] = x;
+    O->Pos[x] = i;
+}
 
-        // is there a unit clause watched by ~v
-        for (int cl = W->Head[v][1]; cl != EOL; cl = W->Next[cl]) {
-            if (is_unit(F, S, cl)) {
-                // success, we found a unit clause watched by v
-                // we update the active list to start searching from here
-                A->last_active = prev != 0 ? prev : A->last_active;
-                return cl;
-            }
+// move the variable at position i down in the heap, until its children have lower activity
+static void percolate_down(order_t* O, int i)
+{
+    int x = O->Heap[i];
+    while (2 * i + 1 < O->size) {
+        int child = 2 * i + 1;
+        if (child + 1 < O->size && O->Activity[O->Heap[child + 1]] > O->Activity[O->Heap[child]]) {
+            child++;
+        }
+        if (O->Activity[O->Heap[child]] <= O->Activity[x]) {
+            break;
         }
+        O->Heap[i] = O->Heap[child];
+        O->Pos[O->Heap[i]] = i;
+        i = child;
+    }
+    O->Heap[i] = x;
+    O->Pos[x] = i;
+}
+
+// check if a variable is in the heap
+int in_order(order_t* O, int var) { return O->Pos[var] != EOL; }
+
+// insert a variable in the heap (if it is not already there)
+void insert_order(order_t* O, int var)
+{
+    if (in_order(O, var)) {
+        return;
+    }
+    O->Heap[O->size] = var;
+    O->size++;
+    percolate_up(O, O->size - 1);
+}
 
-        // next variable
-        prev = v;
-        v = A->NextA[v];
-        if (prev == A->last_active) {
-            return -1;
+// remove the variable with highest activity from the heap and return it
+// (0 if the heap is empty)
+int pop_order(order_t* O)
+{
+    if (O->size == 0) {
+        return 0;
+    }
+    int top = O->Heap[0];
+    O->Pos[top] = EOL;
+    O->size--;
+    if (O->size > 0) {
+        O->Heap[0] = O->Heap[O->size];
+        percolate_down(O, 0);
+    }
+    return top;
+}
+
+// increase the activity of a variable that took part in a conflict
+void bump_order(order_t* O, int var)
+{
+    O->Activity[var] += O->inc;
+    if (O->Activity[var] > 1e100) {
+        // rescale all the activities to avoid overflows (this doesn't change the order)
+        for (int x = 1; x <= O->nb_var; x++) {
+            O->Activity[x] *= 1e-100;
         }
+        O->inc *= 1e-100;
+    }
+    if (in_order(O, var)) {
+        percolate_up(O, O->Pos[var]);
     }
-    assert(0);
+}
+
+// make the activity of all the variables decay, by increasing the amount added by the next bumps
+void decay_order(order_t* O) { O->inc /= O->decay; }
+
+/////////////////////////////
+// dealing with clause arenas
+
+// create an empty clause arena, with room for cap words
+arena_t* new_arena(int cap)
+{
+    arena_t* A = malloc(sizeof(arena_t));
+    A->cap = cap < 1024 ? 1024 : cap;
+    A->Mem = malloc(A->cap * sizeof(int));
+    A->size = 0;
+    A->wasted = 0;
+    return A;
+}
+
+// free a clause arena
+void free_arena(arena_t* A)
+{
+    if (A == NULL)
+        return;
+    free(A->Mem);
+    free(A);
+}
+
+// copy a clause at the end of the arena and return its reference
+// NOTE: this may move the arena in memory, pointers to clauses must not be kept across calls
+int alloc_clause(arena_t* A, int* lits, int size, int learnt)
+{
+    int words = CLAUSE_WORDS(size);
+    if (A->size + words > A->cap) {
+        while (A->size + words > A->cap) {
+            A->cap = 2 * A->cap;
+        }
+        A->Mem = realloc(A->Mem, A->cap * sizeof(int));
+    }
+    int cr = A->size;
+    A->size += words;
+    clause_t* c = CLAUSE(A, cr);
+    c->size = size;
+    c->learnt = learnt;
+    c->vivified = 0;
+    c->deleted = 0;
+    c->moved = 0;
+    c->lbd = size;
+    c->activity = 0.0;
+    memcpy(c->lits, lits, size * sizeof(int));
+    return cr;
+}
+
+// mark a clause as deleted
+// its memory is only reclaimed when the clauses are moved to a new arena (garbage collection)
+void delete_clause(arena_t* A, int cr)
+{
+    clause_t* c = CLAUSE(A, cr);
+    assert(!c->deleted);
+    c->deleted = 1;
+    A->wasted += CLAUSE_WORDS(c->size);
 }
 
 /////////////////////////
@@ -412,14 +886,90 @@ void free_sol(sol_t* S)
     free(S);
 }
 
-// simplify a formula given a partial solution (useful for preprocessing)
-void simplify_CNF(formula_t* F, sol_t* S)
+// initialize an empty reconstruction stack
+extension_t* new_extension()
+{
+    extension_t* E = malloc(sizeof(extension_t));
+    E->nb_cl = 0;
+    E->nb_lit = 0;
+    E->cap_cl = 64;
+    E->cap_lit = 256;
+    E->Cl = malloc((E->cap_cl + 1) * sizeof(int));
+    E->Lit = malloc(E->cap_lit * sizeof(int));
+    E->Cl[0] = 0;
+    return E;
+}
+
+// free a reconstruction stack
+void free_extension(extension_t* E)
+{
+    if (E == NULL)
+        return;
+    free(E->Cl);
+    free(E->Lit);
+    free(E);
+}
+
+// push a clause removed from the formula on the reconstruction stack, with its pivot: a literal of
+// the clause that is made true if the clause is false in the solution
+void push_extension(extension_t* E, int* lits, int size, int pivot)
+{
+    if (E->nb_cl == E->cap_cl) {
+        E->cap_cl *= 2;
+        E->Cl = realloc(E->Cl, (E->cap_cl + 1) * sizeof(int));
+    }
+    while (E->nb_lit + size > E->cap_lit) {
+        E->cap_lit *= 2;
+        E->Lit = realloc(E->Lit, E->cap_lit * sizeof(int));
+    }
+    E->Lit[E->nb_lit++] = pivot;
+    for (int i = 0; i < size; i++) {
+        if (lits[i] != pivot) {
+            E->Lit[E->nb_lit++] = lits[i];
+        }
+    }
+    E->Cl[++E->nb_cl] = E->nb_lit;
+}
+
+// turn a solution of the preprocessed formula into a solution of the initial formula, by going
+// through the reconstruction stack from the last clause to the first one
+void extend_solution(extension_t* E, sol_t* S, int nb_var)
+{
+    // the variables that were removed from the formula need a value
+    for (int x = 1; x <= nb_var; x++) {
+        if (S->State[x] == UNSET) {
+            S->State[x] = FALSE;
+            S->Var[S->n++] = x;
+        }
+    }
+    for (int cl = E->nb_cl - 1; cl >= 0; cl--) {
+        int i;
+        for (i = E->Cl[cl]; i < E->Cl[cl + 1]; i++) {
+            if ((S->State[VARIABLE(E->Lit[i])] & 1) == SIGN(E->Lit[i])) {
+                break;
+            }
+        }
+        if (i == E->Cl[cl + 1]) {
+            int pivot = E->Lit[E->Cl[cl]];
+            S->State[VARIABLE(pivot)] = SIGN(pivot);
+        }
+    }
+}
+
+// remove the satisfied clauses and the false literals of a formula given a partial solution, in
+// place (the order of the remaining literals is kept)
+// if Map is not NULL, Map[cl] receives the new index of clause cl, or EOL if it was removed
+void compact_CNF(formula_t* F, sol_t* S, int* Map)
 {
     int current_new_clause = 0;
     int current_new_i = 0;
+    // F->Cl[cl] may be overwritten by the new start of a clause: we keep the old one
+    int start = F->Cl[0];
     for (int cl = 0; cl < F->nb_cl; cl++) {
+        int end = F->Cl[cl + 1];
         F->Cl[current_new_clause] = current_new_i;
-        for (int i = F->Cl[cl]; i < F->Cl[cl + 1]; i++) {
+        int satisfied = 0;
+        for (int i = start; i < end; i++) {
             int lit = F->Lit[i];
             int x = VARIABLE(lit);
             int s = SIGN(lit);
@@ -433,6 +983,7 @@ void simplify_CNF(formula_t* F, sol_t* S)
             if (S->State[x] != UNSET && (S->State[x] & 1) == s) {
                 current_new_i = F->Cl[current_new_clause];
                 current_new_clause--;
+                satisfied = 1;
                 break;
             }
 
@@ -441,22 +992,47 @@ void simplify_CNF(formula_t* F, sol_t* S)
             current_new_i++;
         }
         current_new_clause++;
+        if (Map != NULL) {
+            Map[cl] = satisfied ? EOL : current_new_clause - 1;
+        }
+        start = end;
     }
     F->nb_cl = current_new_clause;
     F->nb_lit = current_new_i;
     F->Cl[F->nb_cl] = F->nb_lit;
+}
+
+// simplify a formula given a partial solution (useful for preprocessing)
+void simplify_CNF(formula_t* F, sol_t* S)
+{
+    compact_CNF(F, S, NULL);
     F->Lit = realloc(F->Lit, F->nb_lit * sizeof(int));
     F->Cl = realloc(F->Cl, (F->nb_cl + 1) * sizeof(int));
 }
 
+// add clauses (given as in a formula, with nb_cl clauses and nb_lit literals) at the end of F
+void append_clauses(formula_t* F, int* Cl, int* Lit, int nb_cl, int nb_lit)
+{
+    F->Lit = realloc(F->Lit, (F->nb_lit + nb_lit + 1) * sizeof(int));
+    F->Cl = realloc(F->Cl, (F->nb_cl + nb_cl + 1) * sizeof(int));
+    memcpy(F->Lit + F->nb_lit, Lit, nb_lit * sizeof(int));
+    for (int cl = 0; cl < nb_cl; cl++) {
+        F->Cl[F->nb_cl + cl + 1] = F->nb_lit + Cl[cl + 1];
+    }
+    F->nb_cl += nb_cl;
+    F->nb_lit += nb_lit;
+}
+
 int preprocess(formula_t* F, sol_t* S)
 {
     watchlist_t* W = init_watchlists(F);
     activelist_t* A = init_activelist(F, W);
 
+    int r = 0;
     while (1) {
-        if (A->last_active == EOL) {
-            return 1;
+        if (first_active(S, A) == EOL) {
+            r = 1;
+            break;
         }
         int cl = next_unit_clause(F, S, W, A);
         if (cl < 0) {
@@ -464,60 +1040,56 @@ int preprocess(formula_t* F, sol_t* S)
         }
         int lit = F->Lit[F->Cl[cl]];
         int x = VARIABLE(lit);
-        int _x = pop_active(A);
-        (void)_x;
-        assert(x == _x);
         int s = SIGN(lit);
         S->Var[S->n] = x;
         S->n++;
         S->State[x] = 4 + s;
         if (update_watch_lists(F, S, W, A, lit ^ 1) == 0) {
-            return -1;
+            r = -1;
+            break;
         }
     }
     free_watchlist(W);
     free_activelist(A);
-    simplify_CNF(F, S);
-    return 0;
+    if (r == 0) {
+        simplify_CNF(F, S);
+    } else if (r == 1) {
+        // all the clauses are satisfied: as above, the variables set in S don't appear in F anymore
+        F->nb_cl = 0;
+        F->nb_lit = 0;
+        F->Cl[0] = 0;
+    }
+    return r;
 }
 
 int check_watchlists(formula_t* F, sol_t* S, watchlist_t* W)
 {
-    // check that each clause appears in a the watch list of its leading literal
-    // and that this literal is non false
-    // NOTE: the variable at S->n might be set in case we are backtracking. Its value should be
-    // ignored... We "UNSET" it, and put it back at the end.
-    int old_value = -123;
-    if (0 <= S->n && S->n < F->nb_var && S->Var[S->n] != UNSET) {
-        old_value = S->State[S->Var[S->n]];
-        S->State[S->Var[S->n]] = UNSET;
-    }
-
-    char CHECKED[F->nb_cl];
+    // check that each clause is watched by its first two literals (or by its only literal), and
+    // that the blocking literals come from the clause
+    (void)S;
+    char CHECKED[F->nb_cl + 1]; // the formula may be empty after a simplification
     (void)CHECKED;
     for (int cl = 0; cl < F->nb_cl; cl++) {
         CHECKED[cl] = 0;
     }
-    for (int x = 1; x <= F->nb_var; x++) {
-        for (int s = 0; s < 2; s++) {
-            for (int cl = W->Head[x][s]; cl != EOL; cl = W->Next[cl]) {
-                assert(F->Cl[cl] < F->Cl[cl + 1]);
-                int lit = F->Lit[F->Cl[cl]];
-                (void)lit;
-                assert(lit == 2 * x + s);
-                assert((S->State[x] == UNSET) || ((S->State[x] & 1) == s));
-                assert(CHECKED[cl] == 0);
-                CHECKED[cl] = 1;
+    for (int lit = 2; lit < W->nb_lit; lit++) {
+        for (int i = 0; i < W->Size[lit]; i++) {
+            int cl = W->Watch[lit][i].cl;
+            int* c = F->Lit + F->Cl[cl];
+            int size = F->Cl[cl + 1] - F->Cl[cl];
+            (void)c;
+            (void)size;
+            assert(c[0] == lit || (size > 1 && c[1] == lit));
+            int k = 0;
+            while (k < size && c[k] != W->Watch[lit][i].blocker) {
+                k++;
             }
+            assert(k < size);
+            CHECKED[cl]++;
         }
     }
     for (int cl = 0; cl < F->nb_cl; cl++) {
-        assert(CHECKED[cl] == 1);
-    }
-
-    if (0 <= S->n && S->n < F->nb_var && S->Var[S->n] != UNSET) {
-        assert(old_value != -123);
-        S->State[S->Var[S->n]] = old_value;
+        assert(CHECKED[cl] == (F->Cl[cl + 1] - F->Cl[cl] == 1 ? 1 : 2));
     }
     return 1;
 }
@@ -535,15 +1107,15 @@ int check_activelist(formula_t* F, sol_t* S, watchlist_t* W, activelist_t* A)
     }
     int p, v;
     for (p = 0, v = A->NextA[A->last_active]; p != A->last_active; p = v, v = A->NextA[v]) {
-        assert(W->Head[v][0] != EOL || W->Head[v][1] != EOL);
         SEEN[v] = 1;
     }
+    // NOTE: the variable at S->n might be set in case we are backtracking, its watch lists haven't
+    // been updated yet
+    int current = (0 <= S->n && S->n < F->nb_var) ? S->Var[S->n] : UNSET;
+    // unset variables that watch some clause must be active
     for (int x = 1; x <= F->nb_var; x++) {
-        if (SEEN[x] == 0) {
-            for (int s = 0; s < 2; s++) {
-                assert(
-                    (W->Head[x][s] == EOL) || ((S->State[x] != UNSET) && (S->State[x] & 1) == s));
-            }
+        if (SEEN[x] == 0 && x != current && S->State[x] == UNSET) {
+            assert(W->Size[2 * x] == 0 && W->Size[2 * x + 1] == 0);
         }
     }
     return 1;